@@ -0,0 +1,15 @@
+QT -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../LogGenerator/loggenerator.pri)
+
+SOURCES += \
+        benchmark.cpp \
+        main.cpp
+
+HEADERS += \
+        benchmark.h
@@ -0,0 +1,217 @@
+#include "benchmark.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <cstring>
+#include <limits>
+
+//zero the modification time and date in every local and central directory header of a zip
+static void blankZipTimes(QByteArray &zip)
+{
+    char *data = zip.data();
+    for(int i=0;i+16<=zip.size();i++)
+    {
+        if((data[i] != 'P') || (data[i+1] != 'K'))
+            continue;
+        if((data[i+2] == 3) && (data[i+3] == 4))
+            memset(data + i + 10, 0, 4);
+        else if((data[i+2] == 1) && (data[i+3] == 2))
+            memset(data + i + 12, 0, 4);
+    }
+}
+
+Benchmark::Benchmark(const QString &decoder, const QString &workDir) :
+    decoder(decoder),
+    workDir(workDir),
+    logBytes(0),
+    logFrames(0),
+    repeats(3)
+{
+}
+
+void Benchmark::setLog(const QString &fileName, qint64 bytes, quint64 frames)
+{
+    logFile = fileName;
+    logBytes = bytes;
+    logFrames = frames;
+}
+
+//run the decoder once with its outputs going to the work directory, timing it
+bool Benchmark::decode(const QString &mode, int threads, double &seconds)
+{
+    QDir dir(workDir);
+    foreach(const QString &name, dir.entryList(QStringList() << BENCHMARK_OUTPUT "*", QDir::Files))
+        QFile::remove(dir.filePath(name));
+
+    QStringList args;
+    args << "-" + mode << "--threads" << QString::number(threads) << logFile << dir.filePath(BENCHMARK_OUTPUT);
+    QProcess process;
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    QElapsedTimer timer;
+    timer.start();
+    process.start(decoder, args);
+    if(!process.waitForStarted() || !process.waitForFinished(-1))
+        return false;
+    seconds = qMax<qint64>(timer.nsecsElapsed(), 1)/1e9;
+    process.readAll();
+    return (process.exitStatus() == QProcess::NormalExit) && (process.exitCode() == 0);
+}
+
+QMap<QString, QString> Benchmark::hashOutputs() const
+{
+    QMap<QString, QString> hashes;
+    QDir dir(workDir);
+    foreach(const QString &name, dir.entryList(QStringList() << BENCHMARK_OUTPUT "*", QDir::Files, QDir::Name))
+    {
+        QFile file(dir.filePath(name));
+        if(!file.open(QIODevice::ReadOnly))
+            continue;
+        QByteArray data = file.readAll();
+        if(name.endsWith(".sr"))
+            blankZipTimes(data);
+        hashes.insert(name, QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex()));
+    }
+    return hashes;
+}
+
+//every mode at every thread count, false if the decoder failed or the outputs of a mode differ
+bool Benchmark::run()
+{
+    bool same = true;
+    runs.clear();
+    qDebug("%-6s %7s %9s %9s %12s", "mode", "threads", "seconds", "MB/s", "frames/s");
+    foreach(const QString &mode, modes)
+    {
+        int first = -1; //run the other thread counts are compared with
+        foreach(int threadCount, threads)
+        {
+            Result result = {mode, threadCount, std::numeric_limits<double>::max(), QMap<QString, QString>()};
+            for(int i=0;i<repeats;i++)
+            {
+                double seconds;
+                if(!decode(mode, threadCount, seconds))
+                {
+                    qDebug("Decoder failed with -%s --threads %d", qPrintable(mode), threadCount);
+                    return false;
+                }
+                result.seconds = qMin(result.seconds, seconds);
+            }
+            result.hashes = hashOutputs();
+            qDebug("-%-5s %7d %9.3f %9.1f %12.0f", qPrintable(mode), threadCount, result.seconds,
+                   logBytes/1e6/result.seconds, logFrames/result.seconds);
+
+            if(result.hashes.isEmpty())
+            {
+                qDebug("No outputs from -%s", qPrintable(mode));
+                same = false;
+            }
+            else if((first >= 0) && (runs[first].hashes != result.hashes))
+            {
+                qDebug("Outputs of -%s with %d threads differ from %d threads", qPrintable(mode), threadCount, runs[first].threads);
+                same = false;
+            }
+            if(first < 0)
+                first = runs.size();
+            runs.append(result);
+        }
+    }
+    return same;
+}
+
+QJsonObject Benchmark::results() const
+{
+    QJsonArray list;
+    foreach(const Result &result, runs)
+    {
+        QJsonObject entry;
+        entry.insert("mode", result.mode);
+        entry.insert("threads", result.threads);
+        entry.insert("seconds", result.seconds);
+        entry.insert("mbPerSecond", logBytes/1e6/result.seconds);
+        entry.insert("framesPerSecond", logFrames/result.seconds);
+        list.append(entry);
+    }
+    QJsonObject results;
+    results.insert("bytes", logBytes);
+    results.insert("frames", (qint64)logFrames);
+    results.insert("runs", list);
+    return results;
+}
+
+//the hashes of the first run of each mode, with the size of the log they came from
+bool Benchmark::saveGolden(const QString &fileName) const
+{
+    QJsonObject outputs;
+    foreach(const Result &result, runs)
+    {
+        if(outputs.contains(result.mode))
+            continue;
+        QJsonObject files;
+        for(QMap<QString, QString>::const_iterator it=result.hashes.constBegin();it!=result.hashes.constEnd();++it)
+            files.insert(it.key(), it.value());
+        outputs.insert(result.mode, files);
+    }
+    QJsonObject golden;
+    golden.insert("bytes", logBytes);
+    golden.insert("frames", (qint64)logFrames);
+    golden.insert("outputs", outputs);
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(golden).toJson());
+    return true;
+}
+
+bool Benchmark::checkGolden(const QString &fileName) const
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        qDebug("Could not read golden outputs %s", qPrintable(fileName));
+        return false;
+    }
+    QJsonObject golden = QJsonDocument::fromJson(file.readAll()).object();
+    if((golden["bytes"].toDouble() != logBytes) || (golden["frames"].toDouble() != logFrames))
+    {
+        qDebug("Golden outputs are for a different log");
+        return false;
+    }
+
+    bool match = true;
+    QJsonObject outputs = golden["outputs"].toObject();
+    foreach(const Result &result, runs)
+    {
+        if(!outputs.contains(result.mode))
+        {
+            qDebug("No golden outputs for -%s", qPrintable(result.mode));
+            continue;
+        }
+        QJsonObject files = outputs[result.mode].toObject();
+        foreach(const QString &name, files.keys())
+        {
+            if(result.hashes.value(name) != files[name].toString())
+            {
+                qDebug("-%s --threads %d: %s differs from the golden output", qPrintable(result.mode), result.threads, qPrintable(name));
+                match = false;
+            }
+        }
+        foreach(const QString &name, result.hashes.keys())
+        {
+            if(!files.contains(name))
+            {
+                qDebug("-%s --threads %d: %s has no golden output", qPrintable(result.mode), result.threads, qPrintable(name));
+                match = false;
+            }
+        }
+    }
+    if(match)
+        qDebug("Outputs match the golden outputs");
+    return match;
+}
@@ -0,0 +1,56 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#define BENCHMARK_OUTPUT "out" //base name the decoder is given for its outputs
+
+//Times the decoder on a log for each output mode (c, s, p, j, b as on its command line) and
+//thread count, taking the best of a few runs of each.  The outputs of every run are hashed:
+//a mode has to give the same outputs for every thread count, and the hashes can be saved as
+//golden outputs for a later run (of the same generated log) to be checked against.  PulseView
+//files have their zip timestamps blanked before hashing so they only differ if the data does.
+class Benchmark
+{
+public:
+    Benchmark(const QString &decoder, const QString &workDir);
+
+    void setLog(const QString &fileName, qint64 bytes, quint64 frames);
+    void setModes(const QStringList &modes) { this->modes = modes; }
+    void setThreads(const QVector<int> &threads) { this->threads = threads; }
+    void setRepeats(int count) { repeats = count; }
+
+    bool run();
+    QJsonObject results() const;
+    bool checkGolden(const QString &fileName) const;
+    bool saveGolden(const QString &fileName) const;
+
+private:
+    struct Result
+    {
+        QString mode;
+        int threads;
+        double seconds;
+        QMap<QString, QString> hashes; //output file -> hash of its contents
+    };
+
+    bool decode(const QString &mode, int threads, double &seconds);
+    QMap<QString, QString> hashOutputs() const;
+
+    QString decoder;
+    QString workDir;
+    QString logFile;
+    qint64 logBytes;
+    quint64 logFrames;
+    QStringList modes;
+    QVector<int> threads;
+    int repeats;
+    QVector<Result> runs;
+};
+
+#endif // BENCHMARK_H
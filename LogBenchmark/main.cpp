@@ -0,0 +1,164 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include "benchmark.h"
+#include "loggenerator.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("Log Benchmark");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Binary Log Decoder Benchmark");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption decoderPath("decoder", QCoreApplication::translate("main", "Decoder to run (default the one built alongside)"), "file");
+    parser.addOption(decoderPath);
+
+    QCommandLineOption modeList("modes", QCoreApplication::translate("main", "Output modes to time, decoder options without the - (default c,s,p,j)"), "modes", "c,s,p,j");
+    parser.addOption(modeList);
+
+    QCommandLineOption threadList("threads", QCoreApplication::translate("main", "Thread counts to time each mode with (default 1 and all cores)"), "counts");
+    parser.addOption(threadList);
+
+    QCommandLineOption repeatCount("repeat", QCoreApplication::translate("main", "Runs of each, the best time is kept (default 3)"), "count", "3");
+    parser.addOption(repeatCount);
+
+    QCommandLineOption duration("duration", QCoreApplication::translate("main", "Length of the generated log in seconds (default 60)"), "seconds", "60");
+    parser.addOption(duration);
+
+    QCommandLineOption frequency("freq", QCoreApplication::translate("main", "Messages per second of the generated log (default 8789)"), "hz", "8789");
+    parser.addOption(frequency);
+
+    QCommandLineOption layout("layout", QCoreApplication::translate("main", "Message fields of the generated log, as for LogGenerator"), "fields");
+    parser.addOption(layout);
+
+    QCommandLineOption corruptRate("corrupt", QCoreApplication::translate("main", "Average bursts of corrupt bytes per second in the generated log (default 1)"), "rate", "1");
+    parser.addOption(corruptRate);
+
+    QCommandLineOption seed("seed", QCoreApplication::translate("main", "Random seed for the generated log (default 1)"), "number", "1");
+    parser.addOption(seed);
+
+    QCommandLineOption goldenFile("golden", QCoreApplication::translate("main", "Check the outputs against the golden output hashes in this file"), "file");
+    parser.addOption(goldenFile);
+
+    QCommandLineOption updateGolden("update-golden", QCoreApplication::translate("main", "Write the output hashes to the --golden file instead of checking them"));
+    parser.addOption(updateGolden);
+
+    QCommandLineOption reportFile("report", QCoreApplication::translate("main", "Also write the timings to this file as JSON"), "file");
+    parser.addOption(reportFile);
+
+    parser.process(app);
+
+    QString decoder = parser.value(decoderPath);
+    if(decoder.isEmpty())
+    {
+#ifdef Q_OS_WIN
+        decoder = QDir(QCoreApplication::applicationDirPath()).filePath("../LoggingDecode/LoggingDecode.exe");
+#else
+        decoder = QDir(QCoreApplication::applicationDirPath()).filePath("../LoggingDecode/LoggingDecode");
+#endif
+    }
+    if(!QFile::exists(decoder))
+    {
+        qDebug("Decoder %s not found, give it with --decoder", qPrintable(decoder));
+        return 1;
+    }
+
+    QVector<int> threads;
+    if(parser.isSet(threadList))
+    {
+        foreach(const QString &item, parser.value(threadList).split(','))
+        {
+            bool ok;
+            threads.append(item.toInt(&ok));
+            if(!ok || (threads.last() < 1))
+            {
+                qDebug("Invalid thread count");
+                return 1;
+            }
+        }
+    }
+    else
+    {
+        threads.append(1);
+        if(QThread::idealThreadCount() > 1)
+            threads.append(QThread::idealThreadCount());
+    }
+
+    bool ok[5];
+    int repeats = parser.value(repeatCount).toInt(&ok[0]);
+    LogGenerator generator;
+    generator.setDuration(parser.value(duration).toDouble(&ok[1]));
+    generator.setFrequency(parser.value(frequency).toUInt(&ok[2]));
+    generator.setCorruption(parser.value(corruptRate).toDouble(&ok[3]), 32);
+    generator.setSeed(parser.value(seed).toUInt(&ok[4]));
+    for(bool valid : ok)
+    {
+        if(!valid)
+        {
+            qDebug("Invalid option value");
+            return 1;
+        }
+    }
+    if(parser.isSet(layout) && !generator.setLayout(parser.value(layout)))
+    {
+        qDebug("%s", qPrintable(generator.errorString()));
+        return 1;
+    }
+    if(parser.isSet(updateGolden) && !parser.isSet(goldenFile))
+    {
+        qDebug("--update-golden needs --golden");
+        return 1;
+    }
+
+    QTemporaryDir workDir;
+    QString logFile = QDir(workDir.path()).filePath("benchmark.bin");
+    if(!workDir.isValid() || !generator.write(logFile))
+    {
+        qDebug("Could not generate the log: %s", qPrintable(generator.errorString()));
+        return 1;
+    }
+    qDebug("Generated %llu messages, %.1f MB", (unsigned long long)generator.frames(), generator.bytes()/1e6);
+
+    Benchmark benchmark(decoder, workDir.path());
+    benchmark.setLog(logFile, generator.bytes(), generator.frames());
+    benchmark.setModes(parser.value(modeList).split(','));
+    benchmark.setThreads(threads);
+    benchmark.setRepeats(qMax(repeats, 1));
+    bool passed = benchmark.run();
+
+    if(parser.isSet(reportFile))
+    {
+        QFile report(parser.value(reportFile));
+        if(report.open(QIODevice::WriteOnly))
+            report.write(QJsonDocument(benchmark.results()).toJson());
+        else
+            qDebug("Could not write %s", qPrintable(parser.value(reportFile)));
+    }
+
+    if(parser.isSet(goldenFile))
+    {
+        if(parser.isSet(updateGolden))
+        {
+            if(!benchmark.saveGolden(parser.value(goldenFile)))
+            {
+                qDebug("Could not write %s", qPrintable(parser.value(goldenFile)));
+                return 1;
+            }
+            qDebug("Golden outputs written");
+        }
+        else
+            passed &= benchmark.checkGolden(parser.value(goldenFile));
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+# The decoder itself as a static library: log headers, message layout, checksum validation and
+# resync, bit unpacking, spot value assembly and the derived channels, with LogReader as the API
+# for decoding a log in memory.  The LoggingDecode command line tool is built on it, other
+# programs can use it through logdecodelib.pri.
+QT -= gui
+
+TEMPLATE = lib
+CONFIG += c++17 staticlib
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+        decodeplan.cpp \
+        decodestats.cpp \
+        derivedchannels.cpp \
+        framereader.cpp \
+        framesync.cpp \
+        frameunpack.cpp \
+        logheader.cpp \
+        logreader.cpp \
+        logsource.cpp \
+        spotassembler.cpp
+
+HEADERS += \
+        decodeplan.h \
+        decodestats.h \
+        derivedchannels.h \
+        framebatch.h \
+        framereader.h \
+        framesync.h \
+        frameunpack.h \
+        logheader.h \
+        logreader.h \
+        logsource.h \
+        spotassembler.h
@@ -0,0 +1,391 @@
+#include "decodeplan.h"
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+//Read the binary log format definitions (second json header) into varDefs, adding the
+//calculated entries for the standard derived channels and those named in derived when the
+//fields needed for them are present.  If fields isn't empty only the channels named in it are
+//outputs, and derived channels are only added when they are named or another one needs them.
+//The channels in decoded are decoded (and added if derived) without becoming outputs.
+bool parseLogFormat(const QByteArray &json, QVector<varDefinitions> &varDefs, const QStringList &derived, const QStringList &fields, const QStringList &decoded)
+{
+    QJsonDocument jsonResponse = QJsonDocument::fromJson(json);
+    QJsonObject jsonObject = jsonResponse.object();
+    varDefinitions def = {QString(),0,0,0,false,false,false,false};
+    QStringList names;
+
+    varDefs.clear();
+    foreach(const QString& key, jsonObject.keys())
+    {
+        QJsonObject jsonObject2 = jsonObject[key].toObject();
+        foreach(const QString& key2, jsonObject2.keys())
+        {
+            if(key2 == "name")
+            {
+                def.name = jsonObject2[key2].toString();
+                def.isOutput = ((def.name == "csum") || (def.name == "spot")) ? false : true;
+                def.isOutput &= fields.isEmpty() || fields.contains(def.name);
+                def.isDecoded = decoded.contains(def.name);
+            }
+            else if(key2 == "scale")
+                def.scale = jsonObject2[key2].toDouble();
+            else if(key2 == "signed")
+                def.signExtend = jsonObject2[key2].toInt();
+            else if(key2 == "size")
+                def.bits = jsonObject2[key2].toInt();
+        }
+        def.value = 0.0;
+        def.isCalculated = false;
+        names.append(def.name);
+        varDefs.append(def);
+    }
+
+    //work back from the channels asked for, adding the inputs they are made from, first for the
+    //outputs and then for those and the channels that are only decoded
+    int channelCount;
+    const DerivedChannel *channels = derivedChannels(&channelCount);
+    auto wanted = [&](const DerivedChannel &channel, const QStringList &asked)
+    {
+        bool wanted = channel.standard && fields.isEmpty();
+        for(const char *output : channel.outputs)
+            wanted |= (output != nullptr) && asked.contains(QLatin1String(output));
+        return wanted;
+    };
+    auto addInputs = [&](QStringList &asked)
+    {
+        for(int i=channelCount-1;i>=0;i--)
+            for(const char *input : channels[i].inputs)
+                if((input != nullptr) && wanted(channels[i], asked))
+                    asked.append(QLatin1String(input));
+    };
+    QStringList asked = derived + fields;
+    addInputs(asked);
+    QStringList needed = asked + decoded;
+    addInputs(needed);
+
+    for(int i=0;i<channelCount;i++)
+    {
+        const DerivedChannel &channel = channels[i];
+        bool haveInputs = true;
+        for(const char *input : channel.inputs)
+            haveInputs &= (input == nullptr) || names.contains(QLatin1String(input));
+        if(!wanted(channel, needed) || !haveInputs)
+            continue;
+
+        for(const char *output : channel.outputs)
+        {
+            if(output == nullptr)
+                continue;
+            bool isOutput = wanted(channel, asked) && (fields.isEmpty() || fields.contains(QLatin1String(output)));
+            varDefinitions def = {output,0,0,0,false,isOutput,true,decoded.contains(QLatin1String(output))};
+            names.append(def.name);
+            varDefs.append(def);
+        }
+    }
+    return !varDefs.isEmpty();
+}
+
+DecodePlan::DecodePlan() :
+    packedCount(0),
+    msgBytes(0),
+    angleExact(false),
+    counterIndex(-1),
+    spotIndex(-1),
+    counterBitMask(0),
+    modmax(1.0),
+    halfPwm(1.0)
+{
+}
+
+//index of the first entry before end with a name, -1 if there isn't one
+static int indexOf(const QVector<varDefinitions> &varDefs, const char *name, int end)
+{
+    for(int i=0;i<end;i++)
+        if(varDefs[i].name == QLatin1String(name))
+            return i;
+    return -1;
+}
+
+bool DecodePlan::build(const QVector<varDefinitions> &varDefs, double modmax, uint32_t maxpwm)
+{
+    this->modmax = modmax;
+    halfPwm = maxpwm/2;
+    fields.clear();
+    packedCount = 0;
+    derived.clear();
+    angleExact = false;
+    counterIndex = spotIndex = -1;
+
+    int bitOffset = 0;
+    for(int i=0;i<varDefs.size();i++)
+    {
+        const varDefinitions &def = varDefs[i];
+        FieldDesc field;
+        field.bitOffset = bitOffset;
+        field.bits = def.isCalculated ? 0 : def.bits;
+        field.signExtend = def.signExtend;
+        field.scale = def.scale;
+        field.transform = TransformNone;
+        field.needed = def.isOutput || def.isDecoded;
+
+        if(def.isCalculated)
+            field.transform = TransformCalculated;
+        else
+        {
+            if((def.bits < 0) || (def.bits > 32))
+                return false;
+            packedCount = i + 1;
+            bitOffset += def.bits;
+            if(def.name == "angle")
+            {
+                field.transform = TransformAngle;
+                angleExact = (def.scale == 1.0) && !def.signExtend && (def.bits <= 16);
+            }
+            else if((def.name == "ud") || (def.name == "uq"))
+                field.transform = TransformModulation;
+            else if((def.name == "pwm1") || (def.name == "pwm2") || (def.name == "pwm3"))
+                field.transform = TransformPwm;
+            else if(def.name == "count")
+            {
+                field.transform = TransformCounter;
+                counterIndex = i;
+                field.needed = true;
+                counterBitMask = (uint32_t)((1ULL<<def.bits)-1);
+            }
+            else if(def.name == "spot")
+            {
+                field.transform = TransformSpot;
+                spotIndex = i;
+                field.needed = true;
+            }
+        }
+        fields.append(field);
+    }
+
+    //calculated entries always follow the message fields
+    for(int i=0;i<packedCount;i++)
+        if(fields[i].transform == TransformCalculated)
+            return false;
+
+    //derived channels in the order they were added, each after the ones it uses
+    for(int i=packedCount;i<varDefs.size();i++)
+    {
+        const DerivedChannel *channel = findDerivedChannel(varDefs[i].name);
+        if((channel == nullptr) || (varDefs[i].name != QLatin1String(channel->outputs[0])))
+            continue;
+        DerivedStep step;
+        step.channel = channel;
+        bool found = true;
+        for(int j=0;j<DERIVED_MAX_INPUTS;j++)
+        {
+            step.inputs[j] = (channel->inputs[j] == nullptr) ? -1 : indexOf(varDefs, channel->inputs[j], i);
+            found &= (channel->inputs[j] == nullptr) || (step.inputs[j] >= 0);
+        }
+        for(int j=0;j<DERIVED_MAX_OUTPUTS;j++)
+        {
+            step.outputs[j] = (channel->outputs[j] == nullptr) ? -1 : indexOf(varDefs, channel->outputs[j], varDefs.size());
+            found &= (channel->outputs[j] == nullptr) || (step.outputs[j] >= i);
+        }
+        if(!found)
+            continue;
+        derived.append(step);
+        for(int j=0;j<DERIVED_MAX_INPUTS;j++)
+            if(step.inputs[j] >= 0)
+                fields[step.inputs[j]].needed = true;
+    }
+
+    msgBytes = (bitOffset+7)/8;
+    return msgBytes > 0;
+}
+
+//true if a value is always a whole number that fits 32 bits signed (an unscaled field)
+bool DecodePlan::isInteger(int index) const
+{
+    const FieldDesc &field = fields[index];
+    switch(field.transform)
+    {
+    case TransformNone:
+    case TransformCounter:
+    case TransformSpot:
+        return (field.scale == 1.0) && ((field.bits < 32) || field.signExtend);
+    default:
+        return false;
+    }
+}
+
+//unpack one message into values (one entry per varDefinitions entry, stride apart), returns
+//true if the spot assembler completed a full set of spot values while doing so
+bool DecodePlan::decode(const uchar *message, double *values, SpotAssembler &spots, int stride) const
+{
+    bool spotsReady = false;
+    const FieldDesc *field = fields.constData();
+    uint64_t bitStore = 0;
+    int bitsHave = 0;
+    int index = 0;
+
+    for(int i=0;i<packedCount;i++,field++)
+    {
+        int bitsNeeded = field->bits;
+        while(bitsHave < bitsNeeded)
+        {
+            bitStore |= ((uint64_t)message[index++])<<bitsHave;
+            bitsHave += 8;
+        }
+        uint32_t value = (uint32_t)(bitStore & ((1ULL<<bitsNeeded)-1));
+        bitStore = bitStore >> bitsNeeded;
+        bitsHave = bitsHave - bitsNeeded;
+        if(!field->needed)
+            continue;
+        double scaled;
+        if(field->signExtend && (bitsNeeded > 0) && (value & (1U<<(bitsNeeded-1))))
+        { //msb set so extend
+            if(bitsNeeded < 32)
+                value |= 0xffffffff<<bitsNeeded;
+            scaled = ((int32_t)value) * field->scale;
+        }
+        else
+            scaled = value * field->scale;
+
+        switch(field->transform)
+        {
+        case TransformAngle:
+            scaled = (360.0 * (scaled/65535));
+            break;
+        case TransformModulation:
+            scaled = (100.0 * (scaled/modmax));
+            break;
+        case TransformPwm:
+            scaled = (100.0 * ((scaled-halfPwm)/halfPwm));
+            break;
+        case TransformCounter:
+            spots.setCount(value);
+            break;
+        case TransformSpot:
+            spotsReady |= spots.add(value);
+            break;
+        default:
+            break;
+        }
+        values[i*stride] = scaled;
+    }
+
+    derive(values, stride, 1);
+    return spotsReady;
+}
+
+//scale a column of unpacked field values, the same sums decode() does for one message
+void DecodePlan::scaleColumn(const FieldDesc &field, const uint32_t *raw, double *values, int count) const
+{
+    if(field.signExtend)
+    {
+        for(int i=0;i<count;i++)
+            values[i] = ((int32_t)raw[i]) * field.scale;
+    }
+    else
+    {
+        for(int i=0;i<count;i++)
+            values[i] = raw[i] * field.scale;
+    }
+
+    switch(field.transform)
+    {
+    case TransformAngle:
+        for(int i=0;i<count;i++)
+            values[i] = (360.0 * (values[i]/65535));
+        break;
+    case TransformModulation:
+        for(int i=0;i<count;i++)
+            values[i] = (100.0 * (values[i]/modmax));
+        break;
+    case TransformPwm:
+        for(int i=0;i<count;i++)
+            values[i] = (100.0 * ((values[i]-halfPwm)/halfPwm));
+        break;
+    default:
+        break;
+    }
+}
+
+//run the derived channel kernels over count rows, values being the first row of the first
+//column and stride the distance between columns
+void DecodePlan::derive(double *values, int stride, int count) const
+{
+    foreach(const DerivedStep &step, derived)
+    {
+        DerivedColumns columns;
+        for(int i=0;i<DERIVED_MAX_INPUTS;i++)
+            columns.in[i] = (step.inputs[i] >= 0) ? values + step.inputs[i]*stride : nullptr;
+        for(int i=0;i<DERIVED_MAX_OUTPUTS;i++)
+            columns.out[i] = (step.outputs[i] >= 0) ? values + step.outputs[i]*stride : nullptr;
+        columns.count = count;
+        columns.angleExact = angleExact;
+        step.channel->kernel(columns);
+    }
+}
+
+//Decode consecutive messages into the columns of batch, appending rows after any already there.
+//Each field needed is unpacked and scaled for the whole run at once, then the spot values are
+//assembled a message at a time and the derived channels worked out a column at a time.
+void DecodePlan::decode(const uchar *messages, int count, FrameBatch &batch, SpotAssembler &spots, StageTimes *times) const
+{
+    int rows = qMin(count, batch.capacity - batch.rows);
+    if(rows <= 0)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    if(batch.raw.size() < packedCount*rows)
+        batch.raw.resize(packedCount*rows);
+    uint32_t *raw = batch.raw.data();
+    for(int i=0;i<packedCount;i++)
+    {
+        const FieldDesc &field = fields[i];
+        if(!field.needed)
+            continue; //skipped over by bit offset, its column is left as it was
+        uint32_t *column = raw + i*rows;
+        unpackColumn(messages, msgBytes, rows, field.bitOffset, field.bits, field.signExtend, column);
+        scaleColumn(field, column, batch.column(i) + batch.rows, rows);
+    }
+
+    if((counterIndex >= 0) || (spotIndex >= 0))
+    { //in field order, as a message at a time would
+        const uint32_t *counts = (counterIndex >= 0) ? raw + counterIndex*rows : nullptr;
+        const uint32_t *spotBytes = (spotIndex >= 0) ? raw + spotIndex*rows : nullptr;
+        bool countFirst = counterIndex < spotIndex;
+        for(int row=0;row<rows;row++)
+        {
+            if((counts != nullptr) && countFirst)
+                spots.setCount(counts[row]);
+            if((spotBytes != nullptr) && spots.add(spotBytes[row]))
+            {
+                batch.spotRows.append(batch.rows + row);
+                batch.spotValues += spots.completeSet();
+            }
+            if((counts != nullptr) && !countFirst)
+                spots.setCount(counts[row]);
+        }
+    }
+
+    qint64 unpacked = timer.nsecsElapsed();
+    derive(batch.values.data() + batch.rows, batch.capacity, rows);
+    batch.rows += rows;
+    if(times != nullptr)
+    {
+        times->nanos[StageUnpack] += unpacked;
+        times->nanos[StageDerive] += timer.nsecsElapsed() - unpacked;
+    }
+}
+
+//pull just the message counter out of a message, used to check alignment when resyncing
+uint32_t DecodePlan::counter(const uchar *message) const
+{
+    const FieldDesc &field = fields[counterIndex];
+    int first = field.bitOffset>>3;
+    int last = (field.bitOffset+field.bits-1)>>3;
+    uint64_t bitStore = 0;
+    for(int i=last;i>=first;i--)
+        bitStore = (bitStore<<8) | message[i];
+    return (uint32_t)(bitStore>>(field.bitOffset&7)) & counterBitMask;
+}
@@ -0,0 +1,107 @@
+#ifndef DECODEPLAN_H
+#define DECODEPLAN_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+
+#include "decodestats.h"
+#include "derivedchannels.h"
+#include "spotassembler.h"
+#include "framebatch.h"
+#include "frameunpack.h"
+
+struct varDefinitions {
+  QString name;
+  double scale;
+  double value;
+  int bits;
+  bool signExtend;
+  bool isOutput;
+  bool isCalculated;
+  bool isDecoded; //decoded for something else (a trigger) even though it isn't an output
+} ;
+
+bool parseLogFormat(const QByteArray &json, QVector<varDefinitions> &varDefs, const QStringList &derived = QStringList(), const QStringList &fields = QStringList(), const QStringList &decoded = QStringList());
+
+//post processing applied to a field once it has been unpacked and scaled
+enum FieldTransform : quint8
+{
+    TransformNone,
+    TransformAngle,      //0..65535 -> degrees
+    TransformModulation, //ud/uq -> % of modmax
+    TransformPwm,        //pwm1..3 -> % of pwmmax/2 about centre
+    TransformCounter,    //message counter, drives spot value assembly
+    TransformSpot,       //spot value byte
+    TransformCalculated  //not in the message, derived from other fields
+};
+
+struct FieldDesc
+{
+    quint16 bitOffset;
+    quint8 bits;
+    bool signExtend;
+    FieldTransform transform;
+    double scale;
+    bool needed; //an output, decoded, or used for spot values or a derived channel; others aren't unpacked
+};
+
+//Everything the frame loop needs to know about the message layout, worked out once from the
+//format header so decoding a message is a walk over a flat table rather than name compares.
+class DecodePlan
+{
+public:
+    DecodePlan();
+
+    bool build(const QVector<varDefinitions> &varDefs, double modmax, uint32_t maxpwm);
+
+    int messageBytes() const { return msgBytes; }
+    int valueCount() const { return fields.size(); }
+    bool isInteger(int index) const;
+    FieldTransform transform(int index) const { return fields[index].transform; }
+
+    bool checksumValid(const uchar *message) const
+    {
+        uint8_t csum = 0;
+        int i;
+        for(i=0;i<msgBytes-1;i++)
+            csum += message[i];
+        return csum == message[i];
+    }
+    int validMessages(const uchar *messages, int count, qint64 available) const
+    {
+        return validMessageRun(messages, msgBytes, count, available);
+    }
+
+    bool decode(const uchar *message, double *values, SpotAssembler &spots, int stride = 1) const;
+    void decode(const uchar *messages, int count, FrameBatch &batch, SpotAssembler &spots, StageTimes *times = nullptr) const;
+
+    bool hasCounter() const { return counterIndex >= 0; }
+    uint32_t counterMask() const { return counterBitMask; }
+    uint32_t counter(const uchar *message) const;
+
+private:
+    struct DerivedStep
+    {
+        const DerivedChannel *channel;
+        int inputs[DERIVED_MAX_INPUTS]; //varDefinitions indexes, -1 for unused
+        int outputs[DERIVED_MAX_OUTPUTS];
+    };
+
+    void scaleColumn(const FieldDesc &field, const uint32_t *raw, double *values, int count) const;
+    void derive(double *values, int stride, int count) const;
+
+    QVector<FieldDesc> fields; //one per varDefinitions entry, same order
+    int packedCount;           //number of leading entries that come from the message
+    int msgBytes;
+    QVector<DerivedStep> derived;
+    bool angleExact;
+    int counterIndex;
+    int spotIndex;
+    uint32_t counterBitMask;
+    double modmax;
+    double halfPwm;
+};
+
+#endif // DECODEPLAN_H
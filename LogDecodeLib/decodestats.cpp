@@ -0,0 +1,142 @@
+#include "decodestats.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static const char *const stageNames[StageCount] = {"header", "read", "validate", "resync", "unpack", "derive"};
+
+StageTimes::StageTimes()
+{
+    for(int i=0;i<StageCount;i++)
+        nanos[i] = 0;
+}
+
+void StageTimes::add(const StageTimes &other)
+{
+    for(int i=0;i<StageCount;i++)
+        nanos[i] += other.nanos[i];
+}
+
+DecodeStats::DecodeStats() :
+    logs(0),
+    bytes(0),
+    messages(0),
+    lostBytes(0),
+    gaps(0),
+    resyncs(0),
+    countGaps(0),
+    spotSets(0),
+    incompleteSpotSets(0),
+    wallNanos(0),
+    peakMemory(0)
+{
+}
+
+//add the totals of another log, the peak memory being the highest of them
+void DecodeStats::add(const DecodeStats &other)
+{
+    logs += other.logs;
+    bytes += other.bytes;
+    messages += other.messages;
+    lostBytes += other.lostBytes;
+    gaps += other.gaps;
+    resyncs += other.resyncs;
+    countGaps += other.countGaps;
+    spotSets += other.spotSets;
+    incompleteSpotSets += other.incompleteSpotSets;
+    stages.add(other.stages);
+    for(int i=0;i<other.outputNames.size();i++)
+        addOutput(other.outputNames[i], other.outputNanos[i]);
+    wallNanos += other.wallNanos;
+    peakMemory = qMax(peakMemory, other.peakMemory);
+}
+
+void DecodeStats::addOutput(const QString &name, qint64 nanos)
+{
+    int index = outputNames.indexOf(name);
+    if(index < 0)
+    {
+        outputNames.append(name);
+        outputNanos.append(nanos);
+    }
+    else
+        outputNanos[index] += nanos;
+}
+
+void DecodeStats::print() const
+{
+    double seconds = qMax<qint64>(wallNanos, 1)/1e9;
+    qDebug("Decoded %llu frames, %.1f MB in %.3f s (%.1f MB/s, %.0f frames/s)",
+           (unsigned long long)messages, bytes/1e6, seconds, bytes/1e6/seconds, messages/seconds);
+    qDebug("Lost %lld bytes in %d gaps, %d resyncs, %llu count gaps",
+           (long long)lostBytes, gaps, resyncs, (unsigned long long)countGaps);
+    qDebug("Spot value sets: %llu complete, %llu incomplete",
+           (unsigned long long)spotSets, (unsigned long long)incompleteSpotSets);
+    for(int i=0;i<StageCount;i++)
+        qDebug("  %-18s %9.3f s", stageNames[i], stages.nanos[i]/1e9);
+    for(int i=0;i<outputNames.size();i++)
+        qDebug("  %-18s %9.3f s", qPrintable(outputNames[i]), outputNanos[i]/1e9);
+    if(peakMemory > 0)
+        qDebug("Peak memory %.1f MB", peakMemory/1e6);
+}
+
+QJsonObject DecodeStats::toJson() const
+{
+    QJsonObject stageTimes;
+    for(int i=0;i<StageCount;i++)
+        stageTimes.insert(stageNames[i], stages.nanos[i]/1e9);
+    QJsonObject outputTimes;
+    for(int i=0;i<outputNames.size();i++)
+        outputTimes.insert(outputNames[i], outputNanos[i]/1e9);
+
+    QJsonObject report;
+    report.insert("bytes", bytes);
+    report.insert("frames", (qint64)messages);
+    report.insert("lostBytes", lostBytes);
+    report.insert("gaps", gaps);
+    report.insert("resyncs", resyncs);
+    report.insert("countGaps", (qint64)countGaps);
+    report.insert("spotSets", (qint64)spotSets);
+    report.insert("incompleteSpotSets", (qint64)incompleteSpotSets);
+    report.insert("seconds", wallNanos/1e9);
+    report.insert("stageSeconds", stageTimes);
+    report.insert("outputSeconds", outputTimes);
+    report.insert("peakMemory", peakMemory);
+    return report;
+}
+
+//the most memory the process has had resident so far, 0 if it can't be found
+qint64 peakMemoryBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(Q_OS_MACOS)
+    return usage.ru_maxrss; //already bytes
+#else
+    return (qint64)usage.ru_maxrss*1024;
+#endif
+#endif
+}
+
+bool saveStatsReport(const QString &fileName, const QJsonObject &report)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    return file.write(QJsonDocument(report).toJson()) >= 0;
+}
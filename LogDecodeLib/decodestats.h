@@ -0,0 +1,60 @@
+#ifndef DECODESTATS_H
+#define DECODESTATS_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+//where the time decoding a log goes
+enum DecodeStage
+{
+    StageHeader,   //reading the headers and building the decode plan
+    StageRead,     //waiting for streamed log data (page faults on a mapped log count as validate)
+    StageValidate, //checking checksums and copying out the valid messages
+    StageResync,   //searching for the message stream again after a bad message
+    StageUnpack,   //unpacking and scaling the fields, assembling spot values
+    StageDerive,   //calculated channels
+    StageCount
+};
+
+//time spent in each stage by one thread, added together once the threads are done
+struct StageTimes
+{
+    StageTimes();
+    void add(const StageTimes &other);
+
+    qint64 nanos[StageCount];
+};
+
+//What happened decoding a log (or, added together, a batch of logs) for --stats.  Stage and
+//output times are thread time, so with several threads they add up to more than the run took.
+struct DecodeStats
+{
+    DecodeStats();
+
+    void add(const DecodeStats &other);
+    void addOutput(const QString &name, qint64 nanos);
+    void print() const;
+    QJsonObject toJson() const;
+
+    int logs;
+    qint64 bytes;               //size of the log
+    quint64 messages;           //messages written to the outputs
+    qint64 lostBytes;
+    int gaps;
+    int resyncs;                //times a bad message lost the message alignment
+    quint64 countGaps;          //messages whose count doesn't follow on from the one before
+    quint64 spotSets;           //complete sets of spot values written
+    quint64 incompleteSpotSets; //spot value cycles that ended with values missing
+    StageTimes stages;
+    QStringList outputNames;
+    QVector<qint64> outputNanos;
+    qint64 wallNanos;
+    qint64 peakMemory;          //bytes, of the whole process
+};
+
+qint64 peakMemoryBytes();
+bool saveStatsReport(const QString &fileName, const QJsonObject &report);
+
+#endif // DECODESTATS_H
@@ -0,0 +1,111 @@
+#include "derivedchannels.h"
+
+#include <QVector>
+#include <QtMath>
+
+#define ANGLE_STEPS 65536
+#define PARK_BLOCK 256
+
+struct SinCos
+{
+    double sin;
+    double cos;
+};
+
+//sin/cos of every 16 bit angle, each worked out exactly as it would be from the angle in degrees
+static const SinCos *angleTable()
+{
+    static const QVector<SinCos> table = []()
+    {
+        QVector<SinCos> values(ANGLE_STEPS);
+        for(int raw=0;raw<ANGLE_STEPS;raw++)
+        {
+            double angle = qDegreesToRadians(360.0 * (((double)raw)/65535));
+            values[raw].sin = qSin(angle);
+            values[raw].cos = qCos(angle);
+        }
+        return values;
+    }();
+    return table.constData();
+}
+
+static void angleSinCos(const double *degrees, int count, bool exact, double *sinAngle, double *cosAngle)
+{
+    if(exact)
+    { //degrees came from a whole number 0..65535, get it back and look it up
+        const SinCos *table = angleTable();
+        for(int i=0;i<count;i++)
+        {
+            int raw = qBound(0, (int)(degrees[i]*(65535/360.0) + 0.5), ANGLE_STEPS-1);
+            sinAngle[i] = table[raw].sin;
+            cosAngle[i] = table[raw].cos;
+        }
+    }
+    else
+    {
+        for(int i=0;i<count;i++)
+        {
+            double angle = qDegreesToRadians(degrees[i]);
+            sinAngle[i] = qSin(angle);
+            cosAngle[i] = qCos(angle);
+        }
+    }
+}
+
+//Clarke then Park transform of the phase currents, angle i1 i2 -> iq id.  The sin/cos for a
+//block of rows are found first so the transform itself is a plain loop the compiler vectorises.
+static void parkTransform(DerivedColumns &columns)
+{
+    const double *angle = columns.in[0];
+    const double *i1 = columns.in[1];
+    const double *i2 = columns.in[2];
+    double *iq = columns.out[0];
+    double *id = columns.out[1];
+    const double sqrt3 = qSqrt(3.0);
+    double sinAngle[PARK_BLOCK], cosAngle[PARK_BLOCK];
+
+    for(int first=0;first<columns.count;first+=PARK_BLOCK)
+    {
+        int count = qMin(PARK_BLOCK, columns.count - first);
+        angleSinCos(angle + first, count, columns.angleExact, sinAngle, cosAngle);
+        for(int i=0;i<count;i++)
+        {
+            double ia = i1[first+i];
+            double ib = ((ia+(2.0*i2[first+i]))/sqrt3);
+            iq[first+i] = (-ia * sinAngle[i]) + (ib * cosAngle[i]);
+            id[first+i] = (ia * cosAngle[i]) + (ib * sinAngle[i]);
+        }
+    }
+}
+
+//length of the current vector
+static void currentMagnitude(DerivedColumns &columns)
+{
+    const double *iq = columns.in[0];
+    const double *id = columns.in[1];
+    double *is = columns.out[0];
+    for(int i=0;i<columns.count;i++)
+        is[i] = qSqrt((iq[i]*iq[i]) + (id[i]*id[i]));
+}
+
+static const DerivedChannel channels[] =
+{
+    {{"iq", "id"}, {"angle", "i1", "i2"}, true, "q and d axis currents", parkTransform},
+    {{"is", nullptr}, {"iq", "id"}, false, "current vector magnitude", currentMagnitude},
+};
+
+const DerivedChannel *derivedChannels(int *count)
+{
+    *count = sizeof(channels)/sizeof(channels[0]);
+    return channels;
+}
+
+//the channel that makes an output, nullptr if none does
+const DerivedChannel *findDerivedChannel(const QString &output)
+{
+    for(const DerivedChannel &channel : channels)
+        for(const char *name : channel.outputs)
+            if((name != nullptr) && (output == QLatin1String(name)))
+                return &channel;
+    return nullptr;
+}
@@ -0,0 +1,34 @@
+#ifndef DERIVEDCHANNELS_H
+#define DERIVEDCHANNELS_H
+
+#include <QStringList>
+
+#define DERIVED_MAX_INPUTS 4
+#define DERIVED_MAX_OUTPUTS 2
+
+//the columns a derived channel kernel works on, count rows of each
+struct DerivedColumns
+{
+    const double *in[DERIVED_MAX_INPUTS];
+    double *out[DERIVED_MAX_OUTPUTS];
+    int count;
+    bool angleExact; //angle is an unscaled 16 bit field, so its sin/cos can be looked up
+};
+
+//Channels that are worked out from decoded ones rather than read from the message.  Each is a
+//kernel run over whole columns of a batch once the message fields are unpacked, so a channel
+//that isn't asked for costs nothing.  Standard ones are added whenever their inputs are in the
+//log, the rest only when named with --derive.  Inputs can be earlier derived channels.
+struct DerivedChannel
+{
+    const char *outputs[DERIVED_MAX_OUTPUTS]; //names of the channels made, unused ones nullptr
+    const char *inputs[DERIVED_MAX_INPUTS];
+    bool standard;
+    const char *description;
+    void (*kernel)(DerivedColumns &columns);
+};
+
+const DerivedChannel *derivedChannels(int *count);
+const DerivedChannel *findDerivedChannel(const QString &output);
+
+#endif // DERIVEDCHANNELS_H
@@ -0,0 +1,51 @@
+#ifndef FRAMEBATCH_H
+#define FRAMEBATCH_H
+
+#include <QByteArray>
+#include <QVector>
+
+#define FRAME_BATCH_MESSAGES 4096
+
+//checksum valid messages copied out of the log in file order, ready to be decoded
+struct MessageBlock
+{
+    MessageBlock() : count(0) {}
+
+    QByteArray data; //count * messageBytes
+    int count;
+};
+
+//A run of decoded messages held a column (varDefinitions entry) at a time, along with the
+//spot value sets that were completed while decoding them.
+struct FrameBatch
+{
+    FrameBatch() : firstMessage(0), rows(0), capacity(0), columns(0), spotColumns(0) {}
+
+    void reset(int columns, int spotColumns, int capacity = FRAME_BATCH_MESSAGES)
+    {
+        this->columns = columns;
+        this->spotColumns = spotColumns;
+        this->capacity = capacity;
+        values.resize(columns * capacity);
+        spotRows.clear();
+        spotValues.clear();
+        rows = 0;
+    }
+
+    double *column(int index) { return values.data() + index*capacity; }
+    const double *column(int index) const { return values.constData() + index*capacity; }
+    int spotSets() const { return spotRows.size(); }
+    const double *spotSet(int index) const { return spotValues.constData() + index*spotColumns; }
+
+    quint64 firstMessage;       //message number (from the start of the log) of row 0
+    int rows;
+    int capacity;
+    int columns;
+    int spotColumns;
+    QVector<double> values;     //column major, capacity entries per column
+    QVector<int> spotRows;      //row of the message that completed each spot set
+    QVector<double> spotValues; //spotColumns values per set, in spot index order
+    QVector<uint32_t> raw;      //scratch for DecodePlan::decode, kept so reused batches don't allocate
+};
+
+#endif // FRAMEBATCH_H
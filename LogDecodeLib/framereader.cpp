@@ -0,0 +1,168 @@
+#include "framereader.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <cstring>
+#include <limits>
+
+FrameReader::FrameReader(LogSource &source, const DecodePlan &plan) :
+    source(source),
+    plan(plan),
+    sync(plan),
+    messageBytes(plan.messageBytes()),
+    buffer(source.data()),
+    bufferEnd(source.data() + source.available()),
+    inSync(false),
+    validData(false),
+    finished(false),
+    gapStart(0),
+    stopAt(std::numeric_limits<qint64>::max()),
+    number(0),
+    lastMessage(std::numeric_limits<quint64>::max()),
+    nextIndexAt(0),
+    index(nullptr),
+    lost(0),
+    gaps(0),
+    resyncs(0),
+    messageLog(nullptr)
+{
+}
+
+//start reading from a file offset, atMessage meaning it is known to be aligned to a good
+//message (as if the data before it had already been read in sync) numbered firstMessage
+bool FrameReader::start(qint64 offset, bool atMessage, quint64 firstMessage)
+{
+    if(!source.seek(offset))
+        return false;
+    buffer = source.data();
+    bufferEnd = buffer + source.available();
+    inSync = atMessage;
+    validData = atMessage;
+    finished = false;
+    gapStart = offset;
+    number = firstMessage;
+    nextIndexAt = firstMessage;
+    return true;
+}
+
+qint64 FrameReader::haveData(qint64 bytes)
+{
+    if((bufferEnd - buffer) < bytes)
+    { //out of contiguous data, hand back what we have used and ask for more
+        QElapsedTimer timer;
+        timer.start();
+        source.advance(buffer - source.data());
+        source.fill(bytes);
+        times.nanos[StageRead] += timer.nsecsElapsed();
+        buffer = source.data();
+        bufferEnd = buffer + source.available();
+    }
+    return bufferEnd - buffer;
+}
+
+void FrameReader::report(const QString &message)
+{
+    if(messageLog != nullptr)
+        messageLog->append(message);
+    else
+        qDebug("%s", qPrintable(message));
+}
+
+void FrameReader::reportGap(qint64 gapEnd)
+{
+    qint64 gap = gapEnd - gapStart;
+    lost += gap;
+    gaps++;
+    report(QString::asprintf("Message lost: %lld bytes (about %lld messages) at offset %lld",
+                             (long long)gap, (long long)((gap + messageBytes/2)/messageBytes), (long long)gapStart));
+}
+
+void FrameReader::finish()
+{
+    if(finished)
+        return;
+    finished = true;
+    if(!inSync && validData && (stopAt == std::numeric_limits<qint64>::max()) && (number < lastMessage))
+        reportGap(offsetOf(bufferEnd));
+}
+
+//copy up to maxMessages valid messages into block, returns the number copied (0 at the end of the log or range)
+int FrameReader::read(MessageBlock &block, int maxMessages)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 elsewhere = times.nanos[StageRead] + times.nanos[StageResync];
+    if(number >= lastMessage)
+        maxMessages = 0;
+    else if((lastMessage - number) < (quint64)maxMessages)
+        maxMessages = lastMessage - number;
+    if(block.data.size() < maxMessages*messageBytes)
+        block.data.resize(maxMessages*messageBytes);
+    uchar *out = (uchar *)block.data.data();
+    block.count = 0;
+
+    while((block.count < maxMessages) && (haveData(messageBytes) >= messageBytes))
+    {
+        if(!inSync)
+        { //find the next good message, only bytes before the first one aren't counted as lost
+            qint64 length = haveData(sync.lookahead());
+            qint64 searchStart = timer.nsecsElapsed();
+            qint64 resume = 0;
+            qint64 found = sync.find(buffer, length, source.atEnd(), &resume);
+            times.nanos[StageResync] += timer.nsecsElapsed() - searchStart;
+            if(found < 0)
+            {
+                if(resume == 0)
+                    break; //can't tell until more of the log is written
+                buffer += resume;
+                continue;
+            }
+            buffer += found;
+            inSync = true;
+            if(validData)
+                reportGap(offsetOf(buffer));
+        }
+
+        qint64 offset = offsetOf(buffer);
+        if(offset >= stopAt)
+            break;
+
+        //check the run of messages that are already here in one go
+        qint64 available = bufferEnd - buffer;
+        qint64 wanted = qMin<qint64>(maxMessages - block.count, available/messageBytes);
+        if(stopAt != std::numeric_limits<qint64>::max())
+            wanted = qMin<qint64>(wanted, (stopAt - offset + messageBytes - 1)/messageBytes);
+        int run = plan.validMessages(buffer, (int)wanted, available);
+        if(run > 0)
+        { //match, we have valid messages so keep them
+            validData = true;
+            for(int i=0;(index != nullptr) && (i<run);i++)
+            {
+                const uchar *message = buffer + i*messageBytes;
+                if((number + i >= nextIndexAt) && (!plan.hasCounter() || (plan.counter(message) == 0)))
+                { //start of a spot value cycle, record it then wait a while for the next
+                    FrameIndexEntry entry = {number + i, offset + i*messageBytes};
+                    index->append(entry);
+                    nextIndexAt = ((number + i)/FRAME_INDEX_INTERVAL + 1)*FRAME_INDEX_INTERVAL;
+                }
+            }
+            number += run;
+            memcpy(out, buffer, run*messageBytes);
+            out += run*messageBytes;
+            buffer += run*messageBytes;
+            block.count += run;
+        }
+        else //no match so we have lost our place, resync from here
+        {
+            if(validData)
+                resyncs++;
+            inSync = false;
+            gapStart = offset;
+        }
+    }
+
+    if((block.count == 0) && source.atEnd())
+        finish();
+    times.nanos[StageValidate] += timer.nsecsElapsed() - (times.nanos[StageRead] + times.nanos[StageResync] - elsewhere);
+    return block.count;
+}
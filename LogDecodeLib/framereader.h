@@ -0,0 +1,76 @@
+#ifndef FRAMEREADER_H
+#define FRAMEREADER_H
+
+#include <QStringList>
+
+#include "logsource.h"
+#include "decodeplan.h"
+#include "framesync.h"
+#include "framebatch.h"
+
+#define FRAME_INDEX_INTERVAL 8192 //messages between index entries, about a second at 8.8kHz
+
+//a message the reader was in sync on at the start of a spot value cycle (count 0)
+struct FrameIndexEntry
+{
+    quint64 message; //valid messages before this one, time is message/freq
+    qint64 offset;
+};
+
+//First pipeline stage.  Walks the log data after the headers, keeps message alignment with
+//FrameSync and copies out only the messages whose checksum is valid, reporting any bytes
+//lost between them.  It normally reads from the current source position to the end of the
+//file, but can be started part way through and stopped at an offset or message number to
+//read one range.  Index entries can be recorded along the way.  When the source is following a
+//log that is still being written, read() returning 0 only means it has caught up; any partial
+//message is left in the source for the next call.
+class FrameReader
+{
+public:
+    FrameReader(LogSource &source, const DecodePlan &plan);
+
+    bool start(qint64 offset, bool atMessage, quint64 firstMessage = 0);
+    void setStop(qint64 offset) { stopAt = offset; }
+    void setLastMessage(quint64 message) { lastMessage = message; }
+    void setMessageLog(QStringList *log) { messageLog = log; }
+    void setIndex(QVector<FrameIndexEntry> *entries) { index = entries; }
+
+    int read(MessageBlock &block, int maxMessages = FRAME_BATCH_MESSAGES);
+    bool hadValidData() const { return validData; }
+    qint64 position() const { return offsetOf(buffer); }
+    quint64 messageNumber() const { return number; } //of the next message
+    qint64 lostBytes() const { return lost; }
+    int gapCount() const { return gaps; }
+    int resyncCount() const { return resyncs; }
+    const StageTimes &stageTimes() const { return times; } //read, validate and resync
+
+private:
+    qint64 haveData(qint64 bytes);
+    qint64 offsetOf(const uchar *p) const { return source.position() + (p - source.data()); }
+    void reportGap(qint64 gapEnd);
+    void finish();
+    void report(const QString &message);
+
+    LogSource &source;
+    const DecodePlan &plan;
+    FrameSync sync;
+    int messageBytes;
+    const uchar *buffer; //points straight into the mapped/streamed input
+    const uchar *bufferEnd;
+    bool inSync;
+    bool validData;
+    bool finished;
+    qint64 gapStart;
+    qint64 stopAt;
+    quint64 number;
+    quint64 lastMessage;
+    quint64 nextIndexAt;
+    QVector<FrameIndexEntry> *index;
+    qint64 lost;
+    int gaps;
+    int resyncs;
+    StageTimes times;
+    QStringList *messageLog;
+};
+
+#endif // FRAMEREADER_H
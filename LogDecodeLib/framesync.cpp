@@ -0,0 +1,77 @@
+#include "framesync.h"
+
+FrameSync::FrameSync(const DecodePlan &plan, int confirmMessages) :
+    plan(plan),
+    confirmMessages(confirmMessages)
+{
+}
+
+//returns the offset of the first confirmed message in data or -1 if there isn't one, in which
+//case *resume is the offset to restart the search from once more data is available.  When
+//final is set there is no more data to come so a candidate is confirmed against what there is.
+qint64 FrameSync::find(const uchar *data, qint64 length, bool final, qint64 *resume) const
+{
+    int messageBytes = plan.messageBytes();
+    if(length < messageBytes)
+    {
+        *resume = final ? length : 0;
+        return -1;
+    }
+
+    uint8_t csum = 0;
+    for(int i=0;i<messageBytes-1;i++)
+        csum += data[i];
+
+    qint64 last = length - messageBytes;
+    for(qint64 offset=0;;offset++)
+    {
+        if(csum == data[offset+messageBytes-1])
+        {
+            int result = confirm(data, offset, length, final);
+            if(result > 0)
+                return offset;
+            if(result < 0)
+            { //not enough data after the candidate to tell
+                *resume = offset;
+                return -1;
+            }
+        }
+        if(offset == last)
+            break;
+        //slide the window on a byte
+        csum = csum - data[offset] + data[offset+messageBytes-1];
+    }
+    *resume = last + 1;
+    return -1;
+}
+
+//1 if the messages following the candidate at offset check out, 0 if not, -1 if more data is needed
+int FrameSync::confirm(const uchar *data, qint64 offset, qint64 length, bool final) const
+{
+    int messageBytes = plan.messageBytes();
+    qint64 following = (length - offset)/messageBytes - 1;
+    if(following < confirmMessages)
+    {
+        if(!final)
+            return -1;
+    }
+    else
+        following = confirmMessages;
+
+    const uchar *message = data + offset;
+    uint32_t count = plan.hasCounter() ? plan.counter(message) : 0;
+    for(int i=0;i<following;i++)
+    {
+        message += messageBytes;
+        if(!plan.checksumValid(message))
+            return 0;
+        if(plan.hasCounter())
+        {
+            uint32_t next = plan.counter(message);
+            if((next != ((count+1) & plan.counterMask())) && (next != 0))
+                return 0;
+            count = next;
+        }
+    }
+    return 1;
+}
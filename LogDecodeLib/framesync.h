@@ -0,0 +1,26 @@
+#ifndef FRAMESYNC_H
+#define FRAMESYNC_H
+
+#include "decodeplan.h"
+
+#define RESYNC_CONFIRM_MESSAGES 3
+
+//Finds message alignment in a stretch of log data.  Candidates are found with a rolling
+//checksum (one add and one subtract per byte) and are only accepted once the following
+//messages also pass their checksum and the message counter advances across them.
+class FrameSync
+{
+public:
+    explicit FrameSync(const DecodePlan &plan, int confirmMessages = RESYNC_CONFIRM_MESSAGES);
+
+    qint64 find(const uchar *data, qint64 length, bool final, qint64 *resume) const;
+    qint64 lookahead() const { return (qint64)(confirmMessages+1) * plan.messageBytes(); }
+
+private:
+    int confirm(const uchar *data, qint64 offset, qint64 length, bool final) const;
+
+    const DecodePlan &plan;
+    int confirmMessages;
+};
+
+#endif // FRAMESYNC_H
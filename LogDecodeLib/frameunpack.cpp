@@ -0,0 +1,154 @@
+#include "frameunpack.h"
+
+#include <QtEndian>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(FRAME_UNPACK_NO_AVX2)
+#define FRAME_UNPACK_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+static bool detectAvx2()
+{
+#if defined(FRAME_UNPACK_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    if(!(info[2] & (1<<27)) || !(info[2] & (1<<28)) || ((_xgetbv(0) & 6) != 6))
+        return false; //no avx or the os doesn't save the ymm registers
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1<<5)) != 0;
+#elif defined(FRAME_UNPACK_AVX2)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+bool unpackUsesAvx2()
+{
+    static const bool avx2 = detectAvx2();
+    return avx2;
+}
+
+//the bytes of a field near the end of the block, where a whole 64 bit load would run past it
+static inline uint64_t loadPartial(const uchar *p, int bytes)
+{
+    uint64_t word = 0;
+    for(int i=0;i<bytes;i++)
+        word |= ((uint64_t)p[i])<<(8*i);
+    return word;
+}
+
+#ifdef FRAME_UNPACK_AVX2
+//four messages at a time, returns how many it did
+AVX2_FUNCTION static int unpackColumnAvx2(const uchar *p, int messageBytes, int count, int shift, uint32_t mask, int extendShift, uint32_t *out)
+{
+    const __m256i offsets = _mm256_set_epi64x(3LL*messageBytes, 2LL*messageBytes, messageBytes, 0);
+    const __m256i lowHalves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m128i right = _mm_cvtsi32_si128(shift);
+    const __m128i extend = _mm_cvtsi32_si128(extendShift);
+    const __m128i maskBits = _mm_set1_epi32((int)mask);
+    int i;
+    for(i=0;i+4<=count;i+=4,p+=4*messageBytes)
+    {
+        __m256i words = _mm256_i64gather_epi64((const long long *)p, offsets, 1);
+        words = _mm256_srl_epi64(words, right);
+        __m128i values = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(words, lowHalves));
+        values = _mm_and_si128(values, maskBits);
+        values = _mm_sra_epi32(_mm_sll_epi32(values, extend), extend);
+        _mm_storeu_si128((__m128i *)(out + i), values);
+    }
+    return i;
+}
+
+//checks a message per 32 byte load, returns how many were valid
+AVX2_FUNCTION static int validMessageRunAvx2(const uchar *p, int messageBytes, int count)
+{
+    alignas(32) uchar maskBytes[32];
+    for(int i=0;i<32;i++)
+        maskBytes[i] = (i < (messageBytes-1)) ? 0xff : 0;
+    const __m256i mask = _mm256_load_si256((const __m256i *)maskBytes);
+    const __m256i zero = _mm256_setzero_si256();
+    int i;
+    for(i=0;i<count;i++,p+=messageBytes)
+    {
+        __m256i sums = _mm256_sad_epu8(_mm256_and_si256(_mm256_loadu_si256((const __m256i *)p), mask), zero);
+        __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+        if((uint8_t)_mm_cvtsi128_si32(sum) != p[messageBytes-1])
+            break;
+    }
+    return i;
+}
+#endif
+
+//Each field is at most 32 bits and starts within its first byte, so one unaligned 64 bit load
+//from that byte has all of it.  Values come out as uint32, sign extended ones holding the bits
+//of the int32.
+void unpackColumn(const uchar *messages, int messageBytes, int count, int bitOffset, int bits, bool signExtend, uint32_t *out)
+{
+    if(bits <= 0)
+    {
+        for(int i=0;i<count;i++)
+            out[i] = 0;
+        return;
+    }
+    int byte = bitOffset>>3;
+    int shift = bitOffset&7;
+    uint32_t mask = (uint32_t)((1ULL<<bits)-1);
+    int extendShift = signExtend ? 32-bits : 0;
+    const uchar *p = messages + byte;
+
+    //messages that can be read a whole word at a time without going past the block
+    qint64 room = (qint64)count*messageBytes - byte - 8;
+    int whole = (room < 0) ? 0 : (int)qMin<qint64>(count, room/messageBytes + 1);
+
+    int i = 0;
+#ifdef FRAME_UNPACK_AVX2
+    if(unpackUsesAvx2())
+        i = unpackColumnAvx2(p, messageBytes, whole, shift, mask, extendShift, out);
+#endif
+    for(;i<count;i++)
+    {
+        const uchar *field = p + (qint64)i*messageBytes;
+        uint64_t word = (i < whole) ? qFromLittleEndian<quint64>(field) : loadPartial(field, (shift+bits+7)/8);
+        uint32_t value = (uint32_t)(word>>shift) & mask;
+        out[i] = (uint32_t)(((int32_t)(value<<extendShift))>>extendShift);
+    }
+}
+
+int validMessageRun(const uchar *messages, int messageBytes, int count, qint64 available)
+{
+    int i = 0;
+    const uchar *p = messages;
+#ifdef FRAME_UNPACK_AVX2
+    if(unpackUsesAvx2() && (messageBytes >= 2) && (messageBytes <= 33) && (available >= 32))
+    {
+        int whole = (int)qMin<qint64>(count, (available - 32)/messageBytes + 1);
+        i = validMessageRunAvx2(p, messageBytes, whole);
+        if(i < whole)
+            return i;
+        p += (qint64)i*messageBytes;
+    }
+#else
+    Q_UNUSED(available);
+#endif
+    for(;i<count;i++,p+=messageBytes)
+    {
+        uint8_t csum = 0;
+        for(int j=0;j<messageBytes-1;j++)
+            csum += p[j];
+        if(csum != p[messageBytes-1])
+            break;
+    }
+    return i;
+}
@@ -0,0 +1,20 @@
+#ifndef FRAMEUNPACK_H
+#define FRAMEUNPACK_H
+
+#include <QtGlobal>
+#include <cstdint>
+
+//Kernels that work on a block of messages at once rather than a message at a time.  Each has
+//a portable version reading the block a 64 bit word at a time and, on x86, an AVX2 version
+//that is used when the cpu has it.  Neither reads past the end of the block it is given.
+
+bool unpackUsesAvx2();
+
+//one field out of each of count messages (messageBytes apart) into out, sign extended if needed
+void unpackColumn(const uchar *messages, int messageBytes, int count, int bitOffset, int bits, bool signExtend, uint32_t *out);
+
+//number of messages from the start of the block that have a valid checksum, available being
+//how many bytes can be read from messages (at least count * messageBytes)
+int validMessageRun(const uchar *messages, int messageBytes, int count, qint64 available);
+
+#endif // FRAMEUNPACK_H
@@ -0,0 +1,15 @@
+# link the decoder library, for projects built alongside it (add LogDecodeLib to their depends)
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+win32:CONFIG(release, debug|release): LIBDIR = $$OUT_PWD/../LogDecodeLib/release
+else:win32:CONFIG(debug, debug|release): LIBDIR = $$OUT_PWD/../LogDecodeLib/debug
+else: LIBDIR = $$OUT_PWD/../LogDecodeLib
+
+LIBS += -L$$LIBDIR -lLogDecodeLib
+win32-g++: PRE_TARGETDEPS += $$LIBDIR/libLogDecodeLib.a
+else:win32: PRE_TARGETDEPS += $$LIBDIR/LogDecodeLib.lib
+else: PRE_TARGETDEPS += $$LIBDIR/libLogDecodeLib.a
+
+# psapi for the peak memory in the decode statistics
+win32: LIBS += -lpsapi
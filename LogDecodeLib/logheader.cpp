@@ -0,0 +1,74 @@
+#include "logheader.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+
+LogHeader::LogHeader() :
+    freq(0),
+    maxpwm(0),
+    modmax(MODMAX),
+    dataStart(0)
+{
+}
+
+bool readLogHeader(LogSource &source, LogHeader &header, QString &error)
+{
+    if(!source.readJsonObject(header.parameters))
+    {
+        error = "Could not find json header";
+        return false;
+    }
+
+//get params required for decode from json
+    QJsonDocument jsonResponse = QJsonDocument::fromJson(header.parameters);
+    QJsonObject jsonObject = jsonResponse.object();
+    foreach(const QString& key, jsonObject.keys())
+    {
+        QJsonObject jsonObject2 = jsonObject[key].toObject();
+        foreach(const QString& key2, jsonObject2.keys())
+        {
+            if(key2 == "si")
+            {
+                if(key != "version")
+                    header.spotLookup.insert( jsonObject2[key2].toInt(),key);
+            }
+            if(key2 == "value")
+            {
+                if(key == "pwmirqfrq") header.freq = jsonObject2[key2].toInt();
+                if(key == "pwmmax") header.maxpwm = jsonObject2[key2].toInt();
+                if(key == "modmax") header.modmax = jsonObject2[key2].toDouble();
+                if(key == "pwmfrq") //legacy support
+                {
+                    header.freq = 8789;
+                    switch (jsonObject2[key2].toInt())
+                    {
+                    case 0://17k6
+                        header.maxpwm = 4096;
+                        break;
+                    case 1://8k8
+                        header.maxpwm = 8192;
+                        break;
+                    case 2://4k4
+                        header.maxpwm = 16348;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if((header.freq==0) || (header.maxpwm==0))
+    {
+        error = "Could not find pwmmax or pwmirqfrq parameters";
+        return false;
+    }
+
+//read in binary log format definitions
+    if(!source.readJsonObject(header.format))
+    {
+        error = "Could not find json header";
+        return false;
+    }
+    header.dataStart = source.position();
+    return true;
+}
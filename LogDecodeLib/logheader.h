@@ -0,0 +1,31 @@
+#ifndef LOGHEADER_H
+#define LOGHEADER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+
+#include "logsource.h"
+
+#define MODMAX (((2U<<15)/1.732050807568877293527446315059) - 200)
+
+//The two JSON objects a log starts with: the inverter parameters (which give the spot value
+//indexes and the PWM settings the decode depends on) and the message format.
+struct LogHeader
+{
+    LogHeader();
+
+    QByteArray parameters;
+    QByteArray format;
+    QMap<uint32_t, QString> spotLookup; //spot index -> name
+    uint32_t freq;   //pwmirqfrq, messages per second
+    uint32_t maxpwm;
+    double modmax;
+    qint64 dataStart; //offset of the first message
+};
+
+//read both headers from the start of the source, leaving it at the first message.  On failure
+//error says why, and parameters has whatever was read of them.
+bool readLogHeader(LogSource &source, LogHeader &header, QString &error);
+
+#endif // LOGHEADER_H
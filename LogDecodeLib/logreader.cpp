@@ -0,0 +1,89 @@
+#include "logreader.h"
+
+LogReader::LogReader(const QString &fileName) :
+    source(fileName),
+    messageLog(nullptr)
+{
+}
+
+bool LogReader::open(const QStringList &derived, const QStringList &fields)
+{
+    close();
+    if(!source.open())
+    {
+        error = "Could not open input file";
+        return false;
+    }
+    if(!readLogHeader(source, logHeader, error))
+        return false;
+    if(!parseLogFormat(logHeader.format, varDefs, derived, fields) || !plan.build(varDefs, logHeader.modmax, logHeader.maxpwm))
+    {
+        error = "Json header message format invalid";
+        return false;
+    }
+
+    reader.reset(new FrameReader(source, plan));
+    reader->setMessageLog(messageLog);
+    spots.reset(new SpotAssembler(logHeader.spotLookup, plan.counterMask()));
+    return true;
+}
+
+void LogReader::setMessageLog(QStringList *log)
+{
+    messageLog = log;
+    if(!reader.isNull())
+        reader->setMessageLog(log);
+}
+
+void LogReader::close()
+{
+    reader.reset();
+    spots.reset();
+    source.close();
+    logHeader = LogHeader();
+    varDefs.clear();
+    error.clear();
+}
+
+int LogReader::column(const QString &name) const
+{
+    for(int i=0;i<varDefs.size();i++)
+        if(varDefs[i].isOutput && (varDefs[i].name == name))
+            return i;
+    return -1;
+}
+
+bool LogReader::next(FrameBatch &batch, int maxMessages)
+{
+    if(reader.isNull())
+        return false;
+    int count = reader->read(block, maxMessages);
+    if(count <= 0)
+        return false;
+    if((batch.columns != plan.valueCount()) || (batch.spotColumns != logHeader.spotLookup.size()) || (batch.capacity < count))
+        batch.reset(plan.valueCount(), logHeader.spotLookup.size(), qMax(count, maxMessages));
+    else
+    { //keep the storage
+        batch.rows = 0;
+        batch.spotRows.clear();
+        batch.spotValues.clear();
+    }
+    batch.firstMessage = reader->messageNumber() - count;
+    plan.decode((const uchar *)block.data.constData(), count, batch, *spots);
+    return true;
+}
+
+quint64 LogReader::messages() const
+{
+    return reader.isNull() ? 0 : reader->messageNumber();
+}
+
+qint64 LogReader::lostBytes() const
+{
+    return reader.isNull() ? 0 : reader->lostBytes();
+}
+
+int LogReader::gapCount() const
+{
+    return reader.isNull() ? 0 : reader->gapCount();
+}
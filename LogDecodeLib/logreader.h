@@ -0,0 +1,66 @@
+#ifndef LOGREADER_H
+#define LOGREADER_H
+
+#include <QScopedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "decodeplan.h"
+#include "framebatch.h"
+#include "framereader.h"
+#include "logheader.h"
+#include "logsource.h"
+#include "spotassembler.h"
+
+//Decodes a log in memory, for programs that link the decoder library rather than running the
+//decoder and reading its CSV back.  open() reads the headers and builds the decode plan, then
+//each next() decodes the next run of valid messages into a FrameBatch: a column per channel
+//(column i is channels()[i], iq/id and any other derived channels included) and the spot value
+//sets completed along the way (in spotNames() order).  The log is memory mapped where possible
+//and the batch and message buffer are reused from call to call, so once they have grown to
+//size reading a log allocates nothing.
+//
+//    LogReader reader("drive.bin");
+//    FrameBatch batch;
+//    if(reader.open())
+//        while(reader.next(batch))
+//            use(batch.column(reader.column("iq")), batch.rows);
+class LogReader
+{
+public:
+    explicit LogReader(const QString &fileName);
+
+    //derived and fields as for --derive and --fields, fields not asked for aren't decoded
+    bool open(const QStringList &derived = QStringList(), const QStringList &fields = QStringList());
+    void close();
+    QString errorString() const { return error; }
+    //lost data is reported here rather than with qDebug once set, before or after open()
+    void setMessageLog(QStringList *log);
+
+    const LogHeader &header() const { return logHeader; }
+    uint32_t frequency() const { return logHeader.freq; }
+    const QVector<varDefinitions> &channels() const { return varDefs; }
+    int column(const QString &name) const; //-1 if it isn't decoded
+    QStringList spotNames() const { return logHeader.spotLookup.values(); }
+
+    //replaces the contents of batch, false once there are no more messages
+    bool next(FrameBatch &batch, int maxMessages = FRAME_BATCH_MESSAGES);
+
+    quint64 messages() const; //read so far
+    qint64 lostBytes() const;
+    int gapCount() const;
+
+private:
+    LogSource source;
+    LogHeader logHeader;
+    QVector<varDefinitions> varDefs;
+    DecodePlan plan;
+    QScopedPointer<FrameReader> reader;
+    QScopedPointer<SpotAssembler> spots;
+    MessageBlock block;
+    QStringList *messageLog;
+    QString error;
+};
+
+#endif // LOGREADER_H
@@ -0,0 +1,162 @@
+#include "logsource.h"
+
+#include <cstring>
+
+LogSource::LogSource(const QString &fileName) :
+    file(fileName),
+    mapBase(nullptr),
+    bufferOffset(0),
+    cursor(nullptr),
+    end(nullptr),
+    endOfFile(false),
+    following(false)
+{
+}
+
+LogSource::~LogSource()
+{
+    close();
+}
+
+bool LogSource::open()
+{
+    if(!file.open(QFile::ReadOnly | QFile::Unbuffered))
+        return false;
+
+    endOfFile = false;
+    if(!following)
+        mapBase = file.map(0, file.size());
+    if(mapBase != nullptr)
+    {
+        cursor = mapBase;
+        end = mapBase + file.size();
+    }
+    else
+    { //can't map (empty file, pipe, platform limit, still growing etc) so stream it instead
+        buffer.resize(STREAM_BUFFER_SIZE);
+        bufferOffset = 0;
+        cursor = end = (const uchar *)buffer.constData();
+    }
+    return true;
+}
+
+void LogSource::close()
+{
+    if(mapBase != nullptr)
+        file.unmap(mapBase);
+    mapBase = nullptr;
+    cursor = end = nullptr;
+    buffer.clear();
+    file.close();
+}
+
+//make at least minBytes available at data() if the file holds them, returns the number of bytes available
+qint64 LogSource::fill(qint64 minBytes)
+{
+    if((mapBase != nullptr) || (available() >= minBytes) || !file.isOpen())
+        return available();
+
+    //move the unread tail to the front of the buffer then top it up with as much as will fit
+    bufferOffset = position();
+    uchar *base = (uchar *)buffer.data();
+    qint64 remaining = available();
+    if(minBytes > buffer.size())
+    {
+        QByteArray bigger(minBytes, 0);
+        memcpy(bigger.data(), cursor, remaining);
+        buffer = bigger;
+        base = (uchar *)buffer.data();
+    }
+    else if(cursor != base)
+        memmove(base, cursor, remaining);
+    cursor = base;
+    end = base + remaining;
+
+    while(available() < minBytes)
+    {
+        qint64 got = file.read((char *)base + available(), buffer.size() - available());
+        if(got <= 0)
+        {
+            endOfFile = true;
+            break;
+        }
+        end += got;
+    }
+    return available();
+}
+
+void LogSource::advance(qint64 bytes)
+{
+    if(bytes > available())
+        bytes = available();
+    cursor += bytes;
+}
+
+//move the current position to a file offset
+bool LogSource::seek(qint64 position)
+{
+    if(mapBase != nullptr)
+    {
+        if((position < 0) || (position > file.size()))
+            return false;
+        cursor = mapBase + position;
+        return true;
+    }
+    if(!file.seek(position))
+        return false;
+    bufferOffset = position;
+    cursor = end = (const uchar *)buffer.constData();
+    endOfFile = false;
+    return true;
+}
+
+//file offset of data()
+qint64 LogSource::position() const
+{
+    if(mapBase != nullptr)
+        return cursor - mapBase;
+    return bufferOffset + (cursor - (const uchar *)buffer.constData());
+}
+
+//skip to the next '{' and return the complete (brace balanced) object that starts there
+bool LogSource::readJsonObject(QByteArray &json)
+{
+    json.clear();
+    int depth = 0;
+    bool started = false;
+    while(fill(1) > 0)
+    {
+        const uchar *p = data();
+        const uchar *stop = p + available();
+        const uchar *first = p;
+        if(!started)
+        {
+            p = (const uchar *)memchr(p, '{', stop - p);
+            if(p == nullptr)
+            {
+                advance(stop - first);
+                continue;
+            }
+            first = p;
+            started = true;
+        }
+        for(;p < stop;p++)
+        {
+            if(*p == '{')
+                depth++;
+            else if(*p == '}')
+            {
+                if(--depth == 0)
+                {
+                    p++;
+                    json.append((const char *)first, p - first);
+                    advance(p - data());
+                    return true;
+                }
+            }
+        }
+        json.append((const char *)first, stop - first);
+        advance(stop - data());
+    }
+    return false;
+}
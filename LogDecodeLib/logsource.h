@@ -0,0 +1,49 @@
+#ifndef LOGSOURCE_H
+#define LOGSOURCE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+#define STREAM_BUFFER_SIZE (4*1024*1024)
+
+//Read access to a binary log file.  The file is memory mapped where possible so the decoder
+//can work directly on the file bytes, otherwise it is streamed through a large buffer.
+//Either way data() points at contiguous bytes starting at the current position.  A log that is
+//still being written is followed by streaming it and never treating the end of the file as final.
+class LogSource
+{
+public:
+    explicit LogSource(const QString &fileName);
+    ~LogSource();
+
+    void setFollow(bool follow) { following = follow; }
+    bool open();
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    bool isMapped() const { return mapBase != nullptr; }
+
+    qint64 fill(qint64 minBytes);
+    const uchar *data() const { return cursor; }
+    qint64 available() const { return end - cursor; }
+    void advance(qint64 bytes);
+    bool seek(qint64 position);
+    qint64 position() const;
+    qint64 size() const { return file.size(); }
+    QString fileName() const { return file.fileName(); }
+    bool atEnd() const { return (mapBase != nullptr) || (endOfFile && !following); }
+
+    bool readJsonObject(QByteArray &json);
+
+private:
+    QFile file;
+    uchar *mapBase;
+    QByteArray buffer;
+    qint64 bufferOffset; //file offset of the first byte in buffer
+    const uchar *cursor;
+    const uchar *end;
+    bool endOfFile;     //streaming has read everything there is
+    bool following;     //more may be written after the end of the file
+};
+
+#endif // LOGSOURCE_H
@@ -0,0 +1,91 @@
+#include "spotassembler.h"
+
+#include <algorithm>
+
+//Only the spot indexes the counter can reach get an entry in slotOf, so a bad index in the
+//header (a negative si wraps to near 2^32) can't size the table.  A value whose index can't
+//be reached keeps its slot but is never filled, so as before no complete sets are reported.
+SpotAssembler::SpotAssembler(const QMap<uint32_t, QString> &spotLookup, uint32_t counterMask) :
+    values(spotLookup.size()),
+    filled((spotLookup.size() + 63)/64),
+    filledCount(0),
+    spotCount(0),
+    spotVal(0),
+    counted(false),
+    completeCount(0),
+    incompleteCount(0),
+    jumpCount(0)
+{
+    uint32_t reachable = (uint32_t)qMin<quint64>(((quint64)counterMask + 1)>>2, SPOT_MAX_INDEXES);
+    QMap<uint32_t, QString>::const_iterator end = spotLookup.lowerBound(reachable);
+    if(end != spotLookup.constBegin())
+    {
+        QMap<uint32_t, QString>::const_iterator last = end;
+        --last;
+        slotOf.fill(-1, last.key() + 1);
+    }
+    int slot = 0;
+    for(QMap<uint32_t, QString>::const_iterator it=spotLookup.constBegin();it!=end;++it)
+        slotOf[it.key()] = slot++;
+}
+
+//a counter that doesn't follow on from the last one (or wrap to 0) means messages are missing
+void SpotAssembler::setCount(uint32_t count)
+{
+    if(counted && (count != spotCount + 1) && (count != 0))
+        jumpCount++;
+    spotCount = count;
+    counted = true;
+}
+
+//add the spot byte from one message, returns true if this message started a new cycle and
+//the previous one had a full set of values (now in completeSet())
+bool SpotAssembler::add(uint32_t value)
+{
+    bool complete = false;
+    uint32_t spotIndex = spotCount>>2;
+    if(spotIndex == 0)
+    {//may have data to write
+        if(filledCount == values.size()) //do we have a full set of values?
+        {
+            lastSet = values;
+            complete = true;
+            completeCount++;
+        }
+        else if(filledCount > 0)
+            incompleteCount++;
+        std::fill(filled.begin(), filled.end(), 0);
+        filledCount = 0;
+    }
+    int slot = (spotIndex < (uint32_t)slotOf.size()) ? slotOf[spotIndex] : -1;
+    if(slot >= 0)
+    {
+        uint32_t spotByte = spotCount&0x03;
+        if(spotByte==0x00)
+            spotVal = value;
+        else
+            spotVal = spotVal + (value<<(spotByte*8));
+        if(spotByte==0x03)
+        {
+            values[slot] = ((int32_t)spotVal)/32.0;
+            quint64 bit = 1ULL<<(slot&63);
+            if(!(filled[slot>>6] & bit))
+            {
+                filled[slot>>6] |= bit;
+                filledCount++;
+            }
+        }
+    }
+    return complete;
+}
+
+//everything carried on to the next message
+bool SpotAssembler::sameState(const SpotAssembler &other) const
+{
+    if((filled != other.filled) || (spotCount != other.spotCount) || (spotVal != other.spotVal))
+        return false;
+    for(int slot=0;slot<values.size();slot++)
+        if((filled[slot>>6] & (1ULL<<(slot&63))) && (values[slot] != other.values[slot]))
+            return false;
+    return true;
+}
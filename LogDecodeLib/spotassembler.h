@@ -0,0 +1,46 @@
+#ifndef SPOTASSEMBLER_H
+#define SPOTASSEMBLER_H
+
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+#define SPOT_MAX_INDEXES 65536 //higher spot indexes are ignored, a cycle through them would take hours
+
+//Spot values arrive one byte per message, indexed by the message counter (count>>2 selects
+//the value, count&3 the byte).  This rebuilds them and reports when a full set is available.
+//Each spot index in the log is given a slot (in index order, the order of the spot columns)
+//once up front, so a value is just stored in its slot and marked in a bitmap of the slots
+//filled this cycle.  counterMask is the message counter's range, spot indexes above what it
+//can reach are never filled.
+class SpotAssembler
+{
+public:
+    SpotAssembler(const QMap<uint32_t, QString> &spotLookup, uint32_t counterMask);
+
+    void setCount(uint32_t count);
+    bool add(uint32_t value);
+
+    const QVector<double> &completeSet() const { return lastSet; } //one value per slot
+    bool sameState(const SpotAssembler &other) const;
+
+    //running totals for --stats, carried along with the state when it is copied
+    quint64 completeSets() const { return completeCount; }
+    quint64 incompleteSets() const { return incompleteCount; }
+    quint64 countGaps() const { return jumpCount; }
+
+private:
+    QVector<int> slotOf;      //by spot index, -1 for ones that aren't logged
+    QVector<double> values;   //by slot
+    QVector<quint64> filled;  //bit per slot set this cycle
+    int filledCount;
+    QVector<double> lastSet;
+    uint32_t spotCount;
+    uint32_t spotVal;
+    bool counted; //spotCount has been set
+    quint64 completeCount;
+    quint64 incompleteCount;
+    quint64 jumpCount;
+};
+
+#endif // SPOTASSEMBLER_H
@@ -0,0 +1,247 @@
+#include "loggenerator.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#define WRITE_BLOCK_MESSAGES 4096
+#define PHASE_CURRENT 200.0 //amps
+
+//sine of a 16 bit angle as +-32767, a parabola rather than qSin so it is the same on every platform
+static int32_t phaseSine(uint32_t angle)
+{
+    int64_t x = angle & 0x7fff;
+    int32_t y = (int32_t)qMin<int64_t>((4*x*(32768 - x))>>15, 32767);
+    return (angle & 0x8000) ? -y : y;
+}
+
+LogGenerator::LogGenerator() :
+    duration(60),
+    freq(8789),
+    spotCount(40),
+    burstRate(0),
+    maxBurst(32),
+    seed(1),
+    burstLeft(0),
+    frameCount(0),
+    byteCount(0),
+    burstCount(0)
+{
+    setLayout(defaultLayout());
+}
+
+//the fields the decoder knows about, in the order the firmware logs them
+QString LogGenerator::defaultLayout()
+{
+    return "angle:16,i1:12:s:0.25,i2:12:s:0.25,ud:16:s,uq:16:s,pwm1:14,pwm2:14,pwm3:14,count:14,spot:8";
+}
+
+//fields as name:bits[:s][:scale] separated by commas, s meaning signed.  The checksum byte is
+//added after them.
+bool LogGenerator::setLayout(const QString &layout)
+{
+    QVector<GeneratorField> parsed;
+    int bits = 0;
+    foreach(const QString &item, layout.split(','))
+    {
+        QStringList parts = item.trimmed().split(':');
+        GeneratorField field = {parts.value(0), 0, false, 1.0};
+        bool ok = (parts.size() >= 2) && !field.name.isEmpty() && (field.name != "csum");
+        if(ok)
+            field.bits = parts[1].toInt(&ok);
+        for(int i=2;ok && (i<parts.size());i++)
+        {
+            if(parts[i] == "s")
+                field.isSigned = true;
+            else
+                field.scale = parts[i].toDouble(&ok);
+        }
+        if(!ok || (field.bits < 1) || (field.bits > 32) || (field.scale == 0.0))
+        {
+            error = QString("Invalid field \"%1\"").arg(item);
+            return false;
+        }
+        bits += field.bits;
+        parsed.append(field);
+    }
+    if((bits % 8) != 0)
+    {
+        error = "The fields must add up to whole bytes, the checksum is a byte of its own";
+        return false;
+    }
+    fields = parsed;
+    return true;
+}
+
+int LogGenerator::messageBytes() const
+{
+    int bits = 8;
+    foreach(const GeneratorField &field, fields)
+        bits += field.bits;
+    return bits/8;
+}
+
+QByteArray LogGenerator::paramsHeader() const
+{
+    QJsonObject params;
+    QJsonObject value;
+    value.insert("value", (qint64)freq);
+    value.insert("unit", "Hz");
+    params.insert("pwmirqfrq", value);
+    value = QJsonObject();
+    value.insert("value", GENERATOR_MAX_PWM);
+    params.insert("pwmmax", value);
+    value = QJsonObject();
+    value.insert("si", 0);
+    value.insert("value", 0);
+    params.insert("version", value);
+    for(int i=1;i<=spotCount;i++)
+    {
+        QJsonObject spot;
+        spot.insert("si", i);
+        spot.insert("value", 0);
+        params.insert(QString("spot%1").arg(i, 3, 10, QChar('0')), spot);
+    }
+    return QJsonDocument(params).toJson(QJsonDocument::Compact);
+}
+
+//fields keyed by position (zero padded so they sort in order), then the checksum
+QByteArray LogGenerator::formatHeader() const
+{
+    QJsonObject format;
+    int width = QString::number(fields.size()).size();
+    for(int i=0;i<=fields.size();i++)
+    {
+        GeneratorField field = (i < fields.size()) ? fields[i] : GeneratorField{"csum", 8, false, 1.0};
+        QJsonObject def;
+        def.insert("name", field.name);
+        def.insert("size", field.bits);
+        def.insert("signed", field.isSigned ? 1 : 0);
+        def.insert("scale", field.scale);
+        format.insert(QString("%1").arg(i, width, 10, QChar('0')), def);
+    }
+    return QJsonDocument(format).toJson(QJsonDocument::Compact);
+}
+
+//unscaled value of a field for a message
+uint32_t LogGenerator::fieldValue(int index, quint64 frame)
+{
+    const GeneratorField &field = fields[index];
+    uint32_t angle = (uint32_t)((frame*65536ULL*GENERATOR_ELECTRICAL_HZ)/freq);
+    uint32_t count = frame % (4*(spotCount + 1));
+
+    if(field.name == "angle")
+        return angle & 0xffff;
+    if((field.name == "i1") || (field.name == "i2"))
+    {
+        int32_t sine = phaseSine((field.name == "i1") ? angle : angle - 21845);
+        return (uint32_t)qRound(PHASE_CURRENT/field.scale * (sine/32767.0));
+    }
+    if(field.name == "ud")
+        return (uint32_t)(-3000 + (int32_t)(random()%1001) - 500);
+    if(field.name == "uq")
+        return (uint32_t)(20000 + (int32_t)(random()%1001) - 500);
+    if(field.name.startsWith("pwm") && (field.name.size() == 4))
+    {
+        int phase = field.name.at(3).toLatin1() - '1';
+        int32_t sine = phaseSine(angle - phase*21845);
+        return (uint32_t)(GENERATOR_MAX_PWM/2 + ((GENERATOR_MAX_PWM/2 - 100)*sine)/32767);
+    }
+    if(field.name == "count")
+        return count;
+    if(field.name == "spot")
+    { //one byte of a spot value, least significant first, each value drifting a little per cycle
+        uint32_t spot = count>>2;
+        uint32_t byte = count&3;
+        if((byte == 0) && (spot > 0))
+            spotValues[spot] += (int32_t)(random()%321) - 160;
+        return ((uint32_t)spotValues[spot] >> (8*byte)) & 0xff;
+    }
+    return random();
+}
+
+//write over the next bytes with random ones while in a burst, maybe starting one in this message
+void LogGenerator::corrupt(uchar *message, int length)
+{
+    int start = 0;
+    if((burstLeft == 0) && (burstRate > 0) && (random() < burstRate/freq*4294967296.0))
+    {
+        burstLeft = 1 + random()%maxBurst;
+        start = random()%length;
+        burstCount++;
+    }
+    for(int i=start;(i<length) && (burstLeft>0);i++,burstLeft--)
+        message[i] = (uchar)random();
+}
+
+bool LogGenerator::write(const QString &fileName)
+{
+    for(int i=0;i<fields.size();i++)
+    {
+        if((fields[i].name == "count") && ((4ULL*(spotCount + 1)) > (1ULL<<fields[i].bits)))
+        {
+            error = "Too many spot values for the count field";
+            return false;
+        }
+    }
+    if((freq == 0) || (duration <= 0) || (spotCount < 0) || (maxBurst < 1))
+    {
+        error = "Invalid settings";
+        return false;
+    }
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        error = "Could not write " + fileName;
+        return false;
+    }
+
+    random.seed(seed);
+    spotValues.fill(0, spotCount + 1);
+    for(int i=1;i<=spotCount;i++)
+        spotValues[i] = (int32_t)(random()%400001) - 200000;
+    burstLeft = 0;
+    burstCount = 0;
+    frameCount = (quint64)qRound64(duration*freq);
+
+    file.write(paramsHeader());
+    file.write(formatHeader());
+
+    int bytes = messageBytes();
+    QByteArray block(WRITE_BLOCK_MESSAGES*bytes, 0);
+    for(quint64 frame=0;frame<frameCount;)
+    {
+        int count = (int)qMin<quint64>(WRITE_BLOCK_MESSAGES, frameCount - frame);
+        uchar *message = (uchar *)block.data();
+        for(int i=0;i<count;i++,frame++,message+=bytes)
+        { //pack the fields least significant bit first, then the checksum
+            uint64_t bitStore = 0;
+            int bitsHave = 0;
+            int out = 0;
+            for(int j=0;j<fields.size();j++)
+            {
+                uint32_t value = fieldValue(j, frame) & (uint32_t)((1ULL<<fields[j].bits)-1);
+                bitStore |= ((uint64_t)value)<<bitsHave;
+                bitsHave += fields[j].bits;
+                for(;bitsHave>=8;bitsHave-=8,bitStore>>=8)
+                    message[out++] = (uchar)bitStore;
+            }
+            uint8_t csum = 0;
+            for(int j=0;j<bytes-1;j++)
+                csum += message[j];
+            message[bytes-1] = csum;
+            if(frame > 0)
+                corrupt(message, bytes);
+        }
+        if(file.write(block.constData(), (qint64)count*bytes) != (qint64)count*bytes)
+        {
+            error = "Could not write " + fileName;
+            return false;
+        }
+    }
+    byteCount = file.size();
+    file.close();
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef LOGGENERATOR_H
+#define LOGGENERATOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <random>
+
+#define GENERATOR_ELECTRICAL_HZ 50 //motor electrical frequency the phase data is made at
+#define GENERATOR_MAX_PWM 8192
+
+struct GeneratorField
+{
+    QString name;
+    int bits;
+    bool isSigned;
+    double scale;
+};
+
+//Writes a synthetic binary log in the same form as the SD card logger: the parameter JSON,
+//the message format JSON, then packed messages each ending in a checksum byte.  Known fields
+//get plausible data (a rotating angle with matching phase currents and pwm, a count that
+//cycles through the spot values, the spot value bytes), any others random values.  Bursts of
+//random bytes can be written over the messages at a given average rate to exercise resync.
+//Everything comes from a seeded generator using only integer and basic floating point sums, so
+//a given set of options always makes the same log.
+class LogGenerator
+{
+public:
+    LogGenerator();
+
+    static QString defaultLayout();
+    bool setLayout(const QString &layout);
+    void setDuration(double seconds) { duration = seconds; }
+    void setFrequency(uint32_t hz) { freq = hz; }
+    void setSpotCount(int count) { spotCount = count; }
+    void setCorruption(double perSecond, int maxBurst) { burstRate = perSecond; this->maxBurst = maxBurst; }
+    void setSeed(uint32_t seed) { this->seed = seed; }
+
+    bool write(const QString &fileName);
+    QString errorString() const { return error; }
+
+    int messageBytes() const;
+    quint64 frames() const { return frameCount; }
+    qint64 bytes() const { return byteCount; }
+    int bursts() const { return burstCount; }
+
+private:
+    QByteArray paramsHeader() const;
+    QByteArray formatHeader() const;
+    uint32_t fieldValue(int field, quint64 frame);
+    void corrupt(uchar *message, int length);
+
+    QVector<GeneratorField> fields; //not including the checksum
+    double duration;
+    uint32_t freq;
+    int spotCount;
+    double burstRate;
+    int maxBurst;
+    uint32_t seed;
+
+    std::mt19937 random;
+    QVector<int32_t> spotValues; //index 0 is the version, not a spot value
+    int burstLeft;
+    quint64 frameCount;
+    qint64 byteCount;
+    int burstCount;
+    QString error;
+};
+
+#endif // LOGGENERATOR_H
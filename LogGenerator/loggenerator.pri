@@ -0,0 +1,8 @@
+# the generator itself, shared with the benchmark
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+        $$PWD/loggenerator.cpp
+
+HEADERS += \
+        $$PWD/loggenerator.h
@@ -0,0 +1,78 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+
+#include "loggenerator.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("Log Generator");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Synthetic Binary Log Generator");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("dest", QCoreApplication::translate("main", "Log file to write."));
+
+    QCommandLineOption duration("duration", QCoreApplication::translate("main", "Length of the log in seconds (default 60)"), "seconds", "60");
+    parser.addOption(duration);
+
+    QCommandLineOption frequency("freq", QCoreApplication::translate("main", "Messages per second, the pwmirqfrq parameter (default 8789)"), "hz", "8789");
+    parser.addOption(frequency);
+
+    QCommandLineOption layout("layout", QCoreApplication::translate("main", "Message fields as name:bits[:s][:scale],... s meaning signed, the checksum is added (default ") + LogGenerator::defaultLayout() + ")", "fields");
+    parser.addOption(layout);
+
+    QCommandLineOption spots("spots", QCoreApplication::translate("main", "Number of spot values (default 40)"), "count", "40");
+    parser.addOption(spots);
+
+    QCommandLineOption corruptRate("corrupt", QCoreApplication::translate("main", "Average bursts of corrupt bytes per second (default 0)"), "rate", "0");
+    parser.addOption(corruptRate);
+
+    QCommandLineOption burstLength("burst", QCoreApplication::translate("main", "Longest corrupt burst in bytes (default 32)"), "bytes", "32");
+    parser.addOption(burstLength);
+
+    QCommandLineOption seed("seed", QCoreApplication::translate("main", "Random seed, the same seed and options always make the same log (default 1)"), "number", "1");
+    parser.addOption(seed);
+
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if(args.size() != 1)
+    {
+        qDebug("No destination filename provided");
+        return 1;
+    }
+
+    bool ok[6];
+    LogGenerator generator;
+    generator.setDuration(parser.value(duration).toDouble(&ok[0]));
+    generator.setFrequency(parser.value(frequency).toUInt(&ok[1]));
+    generator.setSpotCount(parser.value(spots).toInt(&ok[2]));
+    generator.setCorruption(parser.value(corruptRate).toDouble(&ok[3]), parser.value(burstLength).toInt(&ok[4]));
+    generator.setSeed(parser.value(seed).toUInt(&ok[5]));
+    for(bool valid : ok)
+    {
+        if(!valid)
+        {
+            qDebug("Invalid option value");
+            return 1;
+        }
+    }
+    if(parser.isSet(layout) && !generator.setLayout(parser.value(layout)))
+    {
+        qDebug("%s", qPrintable(generator.errorString()));
+        return 1;
+    }
+
+    if(!generator.write(args.at(0)))
+    {
+        qDebug("%s", qPrintable(generator.errorString()));
+        return 1;
+    }
+    qDebug("Wrote %llu messages of %d bytes (%lld bytes, %d corrupt bursts)",
+           (unsigned long long)generator.frames(), generator.messageBytes(), (long long)generator.bytes(), generator.bursts());
+    return 0;
+}
@@ -1,6 +1,6 @@
 QT -= gui
 
-CONFIG += c++11 console
+CONFIG += c++17 console thread
 CONFIG -= app_bundle
 
 # The following define makes your compiler emit warnings if you use
@@ -14,8 +14,54 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# the decoding itself is in the library next to this
+include(../LogDecodeLib/logdecodelib.pri)
+
 SOURCES += \
-        main.cpp
+        batchdecoder.cpp \
+        chunkdecoder.cpp \
+        columnwriter.cpp \
+        compressedfile.cpp \
+        csvwriter.cpp \
+        envelopesink.cpp \
+        frameindex.cpp \
+        framesinks.cpp \
+        logdecoder.cpp \
+        logfollower.cpp \
+        main.cpp \
+        pipeline.cpp \
+        signalsummary.cpp \
+        srwriter.cpp \
+        triggercapture.cpp \
+        zipwriter.cpp
+
+HEADERS += \
+        batchdecoder.h \
+        chunkdecoder.h \
+        columnwriter.h \
+        compressedfile.h \
+        csvwriter.h \
+        envelopesink.h \
+        frameindex.h \
+        framesinks.h \
+        logdecoder.h \
+        logfollower.h \
+        pipeline.h \
+        signalsummary.h \
+        spscqueue.h \
+        srwriter.h \
+        triggercapture.h \
+        zipwriter.h
+
+# zlib for the PulseView (.sr) zip container
+unix: LIBS += -lz
+win32: LIBS += -lzlib
+
+# zstd for --compress zstd, build with qmake CONFIG+=zstd (gzip needs only zlib)
+zstd {
+    DEFINES += COMPRESS_ZSTD
+    LIBS += -lzstd
+}
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -0,0 +1,165 @@
+#include "batchdecoder.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "frameindex.h"
+
+//files in a log directory that are our own outputs rather than logs
+static const char *const outputSuffixes[] = {"csv", "gz", "zst", "json", "sr", "ldc", "idx"};
+
+static thread_local QString currentLog;
+static QtMessageHandler previousHandler = nullptr;
+
+//prefix messages from a worker with the log it is decoding
+static void batchMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    QString text = currentLog.isEmpty() ? message : currentLog + ": " + message;
+    if(previousHandler != nullptr)
+        previousHandler(type, context, text);
+    else
+        fprintf(stderr, "%s\n", qPrintable(text));
+}
+
+BatchDecoder::BatchDecoder(const DecodeOptions &options) :
+    options(options)
+{
+}
+
+//add the logs in a directory (and below it) or matching a file name pattern, false if there are none
+bool BatchDecoder::addSource(const QString &source)
+{
+    QFileInfo info(source);
+    QStringList found;
+    QDir root;
+    if(info.isDir())
+    {
+        root = QDir(source);
+        QDirIterator files(source, QDir::Files, QDirIterator::Subdirectories);
+        while(files.hasNext())
+            found << files.next();
+    }
+    else
+    {
+        root = info.dir();
+        foreach(const QString &name, root.entryList(QStringList() << info.fileName(), QDir::Files, QDir::Name))
+            found << root.filePath(name);
+    }
+
+    int before = logs.size();
+    foreach(const QString &fileName, found)
+    {
+        QFileInfo file(fileName);
+        bool output = false;
+        for(const char *suffix : outputSuffixes)
+            output |= (file.suffix().toLower() == suffix);
+        if(output)
+            continue;
+        Log log = {fileName, root.relativeFilePath(fileName), file.size()};
+        logs.append(log);
+    }
+    return logs.size() > before;
+}
+
+//base output name for a log, the log name without its extension in the log's directory or under the destination
+QString BatchDecoder::outputBase(const Log &log) const
+{
+    QString base = destination.isEmpty() ? log.fileName : QDir(destination).filePath(log.name);
+    int dot = base.lastIndexOf('.');
+    if(dot > base.lastIndexOf('/'))
+        base = base.left(dot);
+    return base;
+}
+
+//Logs are decoded one per worker, the workers taking the next largest log as they finish one.
+//Only when there are fewer logs than threads do the logs get more than one thread each.
+bool BatchDecoder::run(int threads)
+{
+    std::stable_sort(logs.begin(), logs.end(), [](const Log &a, const Log &b) { return a.size > b.size; });
+    DecodeOptions logOptions = options;
+    logOptions.threads = qMax(1, threads/qMax(logs.size(), 1));
+    logOptions.printStats = false; //the batch reports them instead
+    logOptions.statsFile.clear();
+    int workers = qMin(threads, logs.size());
+
+    DecodePlanCache plans;
+    std::mutex lock;
+    DecodeStats totals;
+    QVector<QJsonObject> logStats(logs.size());
+    int failed = 0;
+    std::atomic<int> next(0);
+    QElapsedTimer timer;
+    timer.start();
+    previousHandler = qInstallMessageHandler(batchMessageHandler);
+
+    auto work = [&]()
+    {
+        for(int index=next++;index<logs.size();index=next++)
+        {
+            const Log &log = logs[index];
+            currentLog = log.name;
+            QString base = outputBase(log);
+            QDir().mkpath(QFileInfo(base).path());
+            //with a destination the index goes there too, leaving the log directory as it was
+            QString indexName = destination.isEmpty() ? QString() : FrameIndex::fileNameFor(QDir(destination).filePath(log.name));
+            DecodeStats stats;
+            bool ok = decodeLog(log.fileName, base, logOptions, plans, &stats, indexName);
+            currentLog.clear();
+
+            std::lock_guard<std::mutex> locker(lock);
+            if(!ok)
+                failed++;
+            totals.add(stats);
+            logStats[index] = stats.toJson();
+            logStats[index].insert("log", log.name);
+            logStats[index].insert("decoded", ok);
+        }
+    };
+    if(workers <= 1)
+        work();
+    else
+    {
+        QVector<std::thread *> pool;
+        for(int i=0;i<workers;i++)
+            pool.append(new std::thread(work));
+        foreach(std::thread *worker, pool)
+        {
+            worker->join();
+            delete worker;
+        }
+    }
+
+    qInstallMessageHandler(previousHandler);
+    double seconds = qMax<qint64>(timer.elapsed(), 1)/1000.0;
+    qDebug("Batch complete: %d logs (%d failed), %llu frames, lost %lld bytes in %d gaps",
+           logs.size(), failed, (unsigned long long)totals.messages, (long long)totals.lostBytes, totals.gaps);
+    qDebug("%.1f MB in %.1f s, %.1f MB/s, %.0f frames/s",
+           totals.bytes/1e6, seconds, totals.bytes/1e6/seconds, totals.messages/seconds);
+    if(options.printStats || !options.statsFile.isEmpty())
+    {
+        totals.wallNanos = timer.nsecsElapsed();
+        totals.peakMemory = peakMemoryBytes();
+    }
+    if(options.printStats)
+        totals.print();
+    if(!options.statsFile.isEmpty())
+    {
+        QJsonArray list;
+        foreach(const QJsonObject &entry, logStats)
+            list.append(entry);
+        QJsonObject report = totals.toJson();
+        report.insert("logs", list);
+        if(!saveStatsReport(options.statsFile, report))
+            qDebug("Could not write %s", qPrintable(options.statsFile));
+    }
+    return failed == 0;
+}
@@ -0,0 +1,40 @@
+#ifndef BATCHDECODER_H
+#define BATCHDECODER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "logdecoder.h"
+
+//Decodes a set of logs for --batch.  The logs are shared out to a pool of worker threads,
+//largest first so one big log found last doesn't leave the others idle at the end, and the
+//decode plan for each log format is built once for the whole batch.  Outputs go next to each
+//log or, with a destination, into the same directory layout under it.  Each console message is
+//prefixed with the log it is about, and the run ends with totals for the whole batch.
+class BatchDecoder
+{
+public:
+    explicit BatchDecoder(const DecodeOptions &options);
+
+    bool addSource(const QString &source);
+    void setDestination(const QString &dir) { destination = dir; }
+    int logCount() const { return logs.size(); }
+    bool run(int threads);
+
+private:
+    struct Log
+    {
+        QString fileName;
+        QString name; //relative to the directory it was found in
+        qint64 size;
+    };
+
+    QString outputBase(const Log &log) const;
+
+    DecodeOptions options;
+    QString destination;
+    QVector<Log> logs;
+};
+
+#endif // BATCHDECODER_H
@@ -0,0 +1,339 @@
+#include "chunkdecoder.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+ChunkedDecoder::ChunkedDecoder(const QString &fileName, qint64 dataStart, const DecodePlan &plan, const QMap<uint32_t, QString> &spotLookup, uint32_t freq) :
+    fileName(fileName),
+    dataStart(dataStart),
+    plan(plan),
+    spotLookup(spotLookup),
+    freq(freq),
+    progressSeconds(PROGRESS_SECONDS),
+    replayBytes(0),
+    messageCount(0),
+    lost(0),
+    gaps(0)
+{
+}
+
+//run task over 0..tasks-1 on a number of threads, each with its own view of the log
+void ChunkedDecoder::parallel(int threads, int tasks, const std::function<void(LogSource &, int)> &task) const
+{
+    std::atomic<int> next(0);
+    QVector<std::thread *> workers;
+    for(int i=0;i<qMin(threads, tasks);i++)
+    {
+        workers.append(new std::thread([&]()
+        {
+            LogSource source(fileName);
+            source.open();
+            for(int index=next++;index<tasks;index=next++)
+                task(source, index);
+        }));
+    }
+    foreach(std::thread *worker, workers)
+    {
+        worker->join();
+        delete worker;
+    }
+}
+
+qint64 ChunkedDecoder::stopOf(int index) const
+{
+    if(index + 1 < chunks.size())
+        return chunks[index+1].start;
+    return std::numeric_limits<qint64>::max();
+}
+
+//offset of the first message a reader resyncing at from would find, -1 if there isn't one
+qint64 ChunkedDecoder::findStart(LogSource &source, qint64 from) const
+{
+    FrameReader reader(source, plan);
+    QStringList discard;
+    reader.setMessageLog(&discard);
+    MessageBlock block;
+    if(!reader.start(from, false) || (reader.read(block, 1) == 0))
+        return -1;
+    return reader.position() - plan.messageBytes();
+}
+
+void ChunkedDecoder::count(LogSource &source, int index)
+{
+    Chunk &chunk = chunks[index];
+    FrameReader reader(source, plan);
+    QStringList discard;
+    reader.setMessageLog(&discard);
+    reader.start(chunk.start, index > 0);
+    reader.setStop(stopOf(index));
+    chunk.entries.clear();
+    reader.setIndex(&chunk.entries);
+
+    MessageBlock block;
+    chunk.messages = 0;
+    while(reader.read(block) > 0)
+        chunk.messages += block.count;
+    chunk.end = reader.position();
+}
+
+//Work out where the chunks go, returns false if the log can't usefully be split.  Any chunk
+//whose start the previous chunk's reader doesn't stop exactly on (it stepped over it still in
+//sync with a different alignment) is merged into the previous one, so every chunk boundary is
+//somewhere a single reader going through the whole log would also pass.
+bool ChunkedDecoder::split(int threads)
+{
+    chunks.clear();
+    LogSource probe(fileName);
+    if(!probe.open() || !probe.isMapped() || (threads < 2))
+        return false;
+    qint64 dataEnd = probe.size();
+
+    //enough of the log before a chunk to see the spot values restart at least once
+    int messageBytes = plan.messageBytes();
+    replayBytes = ((qint64)plan.counterMask() + 1 + 2*(RESYNC_CONFIRM_MESSAGES + 1)) * messageBytes;
+    if(replayBytes > CHUNK_MAX_REPLAY_BYTES)
+        return false;
+    qint64 chunkBytes = qMax<qint64>(CHUNK_MIN_BYTES, 8*replayBytes);
+    int count = (dataEnd - dataStart)/chunkBytes;
+    if(count < 2)
+        return false;
+
+    QVector<qint64> starts(count);
+    starts[0] = dataStart;
+    parallel(threads, count - 1, [&](LogSource &source, int index)
+    {
+        starts[index+1] = findStart(source, dataStart + (index+1)*chunkBytes);
+    });
+    for(int i=0;i<count;i++)
+    {
+        if((starts[i] < 0) || (!chunks.isEmpty() && (starts[i] <= chunks.last().start)))
+            continue;
+        Chunk chunk = {starts[i], 0, 0, 0, QVector<FrameIndexEntry>()};
+        chunks.append(chunk);
+    }
+
+    parallel(threads, chunks.size(), [&](LogSource &source, int index)
+    {
+        this->count(source, index);
+    });
+    for(int i=1;i<chunks.size();)
+    {
+        if(chunks[i-1].end != chunks[i].start)
+        {
+            chunks.remove(i);
+            this->count(probe, i-1);
+        }
+        else
+            i++;
+    }
+
+    quint64 message = 0;
+    for(int i=0;i<chunks.size();i++)
+    {
+        chunks[i].firstMessage = message;
+        message += chunks[i].messages;
+    }
+    messageCount = message;
+    return chunks.size() > 1;
+}
+
+QVector<FrameIndexEntry> ChunkedDecoder::indexEntries() const
+{
+    QVector<FrameIndexEntry> entries;
+    foreach(const Chunk &chunk, chunks)
+    {
+        foreach(FrameIndexEntry entry, chunk.entries)
+        {
+            entry.message += chunk.firstMessage;
+            entries.append(entry);
+        }
+    }
+    return entries;
+}
+
+//decode the stretch of log before a chunk into spots, leaving it with the state a reader
+//arriving at the chunk from the start of the log would have
+void ChunkedDecoder::replay(LogSource &source, int index, SpotAssembler &spots) const
+{
+    FrameReader reader(source, plan);
+    QStringList discard;
+    reader.setMessageLog(&discard);
+    reader.start(qMax(dataStart, chunks[index].start - replayBytes), false);
+    reader.setStop(chunks[index].start);
+
+    MessageBlock block;
+    QVector<double> values(plan.valueCount());
+    while(reader.read(block) > 0)
+    {
+        const uchar *message = (const uchar *)block.data.constData();
+        for(int i=0;i<block.count;i++,message+=plan.messageBytes())
+            plan.decode(message, values.data(), spots);
+    }
+}
+
+//decode and encode one chunk, starting from the given spot state or a replayed one if null
+QSharedPointer<ChunkedDecoder::ChunkResult> ChunkedDecoder::decode(LogSource &source, int index, const SpotAssembler *spots) const
+{
+    QSharedPointer<ChunkResult> result(new ChunkResult(spotLookup, plan.counterMask()));
+    if(!source.isOpen())
+    {
+        result->failed = true;
+        return result;
+    }
+
+    const Chunk &chunk = chunks[index];
+    SpotAssembler assembler(spotLookup, plan.counterMask());
+    if(spots != nullptr)
+        assembler = *spots;
+    else if(index > 0)
+        replay(source, index, assembler);
+    result->startSpots = assembler;
+
+    FrameReader reader(source, plan);
+    reader.setMessageLog(&result->messages);
+    reader.start(chunk.start, index > 0, chunk.firstMessage);
+    reader.setStop(stopOf(index));
+
+    result->encoded->blocks.resize(sinks.size());
+    MessageBlock block;
+    FrameBatch batch;
+    QElapsedTimer timer;
+    quint64 message = chunk.firstMessage;
+    while(reader.read(block) > 0)
+    {
+        batch.reset(plan.valueCount(), spotLookup.size(), block.count);
+        batch.firstMessage = message;
+        plan.decode((const uchar *)block.data.constData(), block.count, batch, assembler, &result->times);
+        result->messages << progressMessages(message, message + batch.rows, freq, progressSeconds);
+        message += batch.rows;
+
+        for(int i=0;i<sinks.size();i++)
+        {
+            timer.start();
+            QByteArray encoded;
+            sinks[i]->encode(batch, encoded);
+            if(!encoded.isEmpty())
+                result->encoded->blocks[i].append(encoded);
+            sinks[i]->addTime(timer.nsecsElapsed());
+        }
+    }
+    result->endSpots = assembler;
+    result->lostBytes = reader.lostBytes();
+    result->gapCount = reader.gapCount();
+    result->resyncs = reader.resyncCount();
+    result->times.add(reader.stageTimes());
+    return result;
+}
+
+bool ChunkedDecoder::run(int threads)
+{
+    int count = chunks.size();
+    QVector<QSharedPointer<ChunkResult> > results(count);
+    std::mutex lock;
+    std::condition_variable changed;
+    int committed = 0;
+    int window = qMax(threads, 1) * CHUNK_WINDOW_PER_THREAD;
+
+    //each output appends on its own thread, so one slow output doesn't hold the others up
+    QList<WriterStage *> stages;
+    for(int i=0;i<sinks.size();i++)
+        stages.append(new WriterStage(QList<FrameSink *>() << sinks[i], QList<int>() << i, true, 2));
+
+    std::atomic<int> next(0);
+    QVector<std::thread *> workers;
+    for(int i=0;i<qMin(threads, count);i++)
+    {
+        workers.append(new std::thread([&]()
+        {
+            LogSource source(fileName);
+            source.open();
+            for(int index=next++;index<count;index=next++)
+            {
+                {
+                    std::unique_lock<std::mutex> locker(lock);
+                    changed.wait(locker, [&]() { return index < committed + window; });
+                }
+                QSharedPointer<ChunkResult> result = decode(source, index, nullptr);
+                {
+                    std::lock_guard<std::mutex> locker(lock);
+                    results[index] = result;
+                }
+                changed.notify_all();
+            }
+        }));
+    }
+
+    //put the chunks back together in order
+    LogSource source(fileName);
+    SpotAssembler previous(spotLookup, plan.counterMask());
+    lost = 0;
+    gaps = 0;
+    counts = DecodeStats();
+    for(int index=0;index<count;index++)
+    {
+        QSharedPointer<ChunkResult> result;
+        {
+            std::unique_lock<std::mutex> locker(lock);
+            changed.wait(locker, [&]() { return !results[index].isNull(); });
+            result.swap(results[index]);
+        }
+        if(result->failed || ((index > 0) && !result->startSpots.sameState(previous)))
+        { //the replay didn't rebuild the same spot state (or the worker couldn't read), do it again from the real one
+            if(!source.isOpen())
+                source.open();
+            result = decode(source, index, &previous);
+        }
+
+        foreach(const QString &message, result->messages)
+            qDebug("%s", qPrintable(message));
+        lost += result->lostBytes;
+        gaps += result->gapCount;
+        counts.resyncs += result->resyncs;
+        counts.spotSets += result->endSpots.completeSets() - result->startSpots.completeSets();
+        counts.incompleteSpotSets += result->endSpots.incompleteSets() - result->startSpots.incompleteSets();
+        counts.countGaps += result->endSpots.countGaps() - result->startSpots.countGaps();
+        counts.stages.add(result->times);
+
+        WriterJob job;
+        job.encoded = result->encoded;
+        foreach(WriterStage *stage, stages)
+            stage->post(job);
+        previous = result->endSpots;
+
+        {
+            std::lock_guard<std::mutex> locker(lock);
+            committed = index + 1;
+        }
+        changed.notify_all();
+    }
+
+    foreach(std::thread *worker, workers)
+    {
+        worker->join();
+        delete worker;
+    }
+    if(gaps > 0)
+        qDebug("Lost %lld bytes in %d gaps", (long long)lost, gaps);
+
+    bool ok = true;
+    foreach(WriterStage *stage, stages)
+    {
+        ok &= stage->finish();
+        delete stage;
+    }
+    return ok;
+}
+
+void ChunkedDecoder::addStats(DecodeStats &stats) const
+{
+    stats.resyncs += counts.resyncs;
+    stats.spotSets += counts.spotSets;
+    stats.incompleteSpotSets += counts.incompleteSpotSets;
+    stats.countGaps += counts.countGaps;
+    stats.stages.add(counts.stages);
+}
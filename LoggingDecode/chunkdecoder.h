@@ -0,0 +1,101 @@
+#ifndef CHUNKDECODER_H
+#define CHUNKDECODER_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QSharedPointer>
+#include <functional>
+
+#include "pipeline.h"
+
+#define CHUNK_MIN_BYTES (4*1024*1024)
+#define CHUNK_MAX_REPLAY_BYTES (16*1024*1024)
+#define CHUNK_WINDOW_PER_THREAD 2 //chunks decoded ahead of the one being written, per thread
+
+//Decodes one log as a number of byte ranges at the same time.
+//
+//The ranges are cut where a reader resyncing from that point would pick the message stream
+//up, then every range is read once to count its messages so each one knows the number of
+//its first message (and so the times) before it is decoded.  A range is decoded after first
+//replaying the counter cycle before it through a spot assembler, which rebuilds the spot value
+//state the previous range will finish with; the state is checked against the previous range
+//as the results are put back in order and the range is decoded again if it doesn't match.
+//Each range is encoded for every sink by the worker that decoded it, leaving only the
+//appending of the encoded blocks to be done in order.  The counting pass also collects the
+//frame index entries, so splitting alone is a quick way to index a log.
+class ChunkedDecoder
+{
+public:
+    ChunkedDecoder(const QString &fileName, qint64 dataStart, const DecodePlan &plan, const QMap<uint32_t, QString> &spotLookup, uint32_t freq);
+
+    void addSink(FrameSink *sink) { sinks.append(sink); }
+    void setProgressInterval(int seconds) { progressSeconds = seconds; }
+    bool split(int threads);
+    int chunkCount() const { return chunks.size(); }
+    bool run(int threads);
+
+    quint64 messages() const { return messageCount; }
+    qint64 lostBytes() const { return lost; }
+    int gapCount() const { return gaps; }
+    QVector<FrameIndexEntry> indexEntries() const;
+    void addStats(DecodeStats &stats) const;
+
+private:
+    struct Chunk
+    {
+        qint64 start; //first message (chunk 0: start of the data, not necessarily a message)
+        qint64 end;   //where reading stopped, the start of the next chunk
+        quint64 firstMessage;
+        quint64 messages;
+        QVector<FrameIndexEntry> entries; //numbered from the start of the chunk
+    };
+
+    struct ChunkResult
+    {
+        ChunkResult(const QMap<uint32_t, QString> &spotLookup, uint32_t counterMask) :
+            encoded(new EncodedChunk),
+            startSpots(spotLookup, counterMask),
+            endSpots(spotLookup, counterMask),
+            lostBytes(0),
+            gapCount(0),
+            resyncs(0),
+            failed(false)
+        {
+        }
+
+        QSharedPointer<EncodedChunk> encoded;
+        SpotAssembler startSpots;
+        SpotAssembler endSpots;
+        QStringList messages;
+        qint64 lostBytes;
+        int gapCount;
+        int resyncs;
+        StageTimes times;
+        bool failed;
+    };
+
+    qint64 stopOf(int index) const;
+    qint64 findStart(LogSource &source, qint64 from) const;
+    void count(LogSource &source, int index);
+    void replay(LogSource &source, int index, SpotAssembler &spots) const;
+    QSharedPointer<ChunkResult> decode(LogSource &source, int index, const SpotAssembler *spots) const;
+    void parallel(int threads, int tasks, const std::function<void(LogSource &, int)> &task) const;
+
+    QString fileName;
+    qint64 dataStart;
+    const DecodePlan &plan;
+    QMap<uint32_t, QString> spotLookup;
+    uint32_t freq;
+    int progressSeconds;
+    qint64 replayBytes;
+    QVector<Chunk> chunks;
+    QList<FrameSink *> sinks;
+    quint64 messageCount;
+    qint64 lost;
+    int gaps;
+    DecodeStats counts; //the rest of what addStats() gives, added up as the chunks are put in order
+};
+
+#endif // CHUNKDECODER_H
@@ -0,0 +1,245 @@
+#include "columnwriter.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstring>
+#include <limits>
+#include <zlib.h>
+
+static int typeBytes(ColumnType type)
+{
+    return (type == ColumnInt32) ? 4 : 8;
+}
+
+static QString typeName(ColumnType type)
+{
+    switch(type)
+    {
+    case ColumnInt32:
+        return "int32";
+    case ColumnInt64:
+        return "int64";
+    default:
+        return "float64";
+    }
+}
+
+ColumnWriter::ColumnWriter(const QString &fileName, uint32_t freq) :
+    file(fileName),
+    freq(freq),
+    offset(0),
+    failed(false)
+{
+    motor.name = "motor";
+    motor.groupRows = COLUMN_GROUP_ROWS;
+    motor.sequential = true;
+    spot.name = "spot";
+    spot.groupRows = COLUMN_SPOT_GROUP_ROWS;
+    spot.sequential = false;
+}
+
+void ColumnWriter::setColumns(Table &table, const QStringList &names, const QVector<ColumnType> &types)
+{
+    table.names = names;
+    table.types = types;
+    table.data.resize(names.size());
+    table.minimum.resize(names.size());
+    table.maximum.resize(names.size());
+    table.rows = 0;
+    table.firstMessage = 0;
+    table.totalRows = 0;
+    table.groups = QJsonArray();
+}
+
+void ColumnWriter::setMotorColumns(const QStringList &names, const QVector<ColumnType> &types)
+{
+    setColumns(motor, names, types);
+}
+
+//the spot table starts with the message number each set was completed on
+void ColumnWriter::setSpotColumns(const QStringList &names)
+{
+    QVector<ColumnType> types(names.size() + 1, ColumnFloat64);
+    types[0] = ColumnInt64;
+    setColumns(spot, QStringList() << "message" << names, types);
+}
+
+bool ColumnWriter::open()
+{
+    failed = !file.open(QFile::WriteOnly);
+    offset = 0;
+    return !failed && write(COLUMN_FILE_MAGIC, 8);
+}
+
+bool ColumnWriter::write(const char *data, qint64 size)
+{
+    if(!failed && (file.write(data, size) != size))
+        failed = true;
+    offset += size;
+    return !failed;
+}
+
+//add rows given a column at a time, columns holds rows values for each column in turn
+void ColumnWriter::addRows(Table &table, quint64 firstMessage, const double *columns, int rows)
+{
+    if(table.sequential && (table.rows > 0) && (firstMessage != table.firstMessage + table.rows))
+        writeGroup(table); //the messages don't follow on, start a new group
+
+    int row = 0;
+    while(row < rows)
+    {
+        if(table.rows == 0)
+        {
+            table.firstMessage = firstMessage + row;
+            table.minimum.fill(std::numeric_limits<double>::infinity());
+            table.maximum.fill(-std::numeric_limits<double>::infinity());
+        }
+        int count = qMin(rows - row, table.groupRows - table.rows);
+        for(int i=0;i<table.names.size();i++)
+        {
+            const double *in = columns + (qint64)i*rows + row;
+            QByteArray &data = table.data[i];
+            int start = data.size();
+            data.resize(start + count*typeBytes(table.types[i]));
+            double minimum = table.minimum[i];
+            double maximum = table.maximum[i];
+            for(int j=0;j<count;j++)
+            {
+                minimum = qMin(minimum, in[j]);
+                maximum = qMax(maximum, in[j]);
+            }
+            table.minimum[i] = minimum;
+            table.maximum[i] = maximum;
+
+            switch(table.types[i])
+            {
+            case ColumnInt32:
+            {
+                qint32 *out = (qint32 *)(data.data() + start);
+                for(int j=0;j<count;j++)
+                    out[j] = (qint32)in[j];
+                break;
+            }
+            case ColumnInt64:
+            {
+                qint64 *out = (qint64 *)(data.data() + start);
+                for(int j=0;j<count;j++)
+                    out[j] = (qint64)in[j];
+                break;
+            }
+            default:
+                memcpy(data.data() + start, in, count*sizeof(double));
+                break;
+            }
+        }
+        row += count;
+        table.rows += count;
+        if(table.rows == table.groupRows)
+            writeGroup(table);
+    }
+}
+
+void ColumnWriter::addMotorRows(quint64 firstMessage, const double *columns, int rows)
+{
+    addRows(motor, firstMessage, columns, rows);
+}
+
+void ColumnWriter::addSpotRows(const double *columns, int rows)
+{
+    if(rows > 0)
+        addRows(spot, (quint64)columns[0], columns, rows);
+}
+
+//compress and write out the current row group of a table, recording where each column went
+void ColumnWriter::writeGroup(Table &table)
+{
+    if(table.rows == 0)
+        return;
+
+    QJsonArray chunks;
+    for(int i=0;i<table.names.size();i++)
+    {
+        QByteArray &data = table.data[i];
+        int size = typeBytes(table.types[i]);
+        shuffled.resize(data.size());
+        const uchar *in = (const uchar *)data.constData();
+        uchar *out = (uchar *)shuffled.data();
+        for(int b=0;b<size;b++)
+            for(int row=0;row<table.rows;row++)
+                *out++ = in[row*size + b];
+
+        //fastest level, this runs on the output's writer thread for every value decoded
+        uLongf length = compressBound(data.size());
+        if(deflated.size() < (int)length)
+            deflated.resize(length);
+        ColumnEncoding encoding = EncodingPlain;
+        const char *payload = data.constData();
+        if((compress2((Bytef *)deflated.data(), &length, (const Bytef *)shuffled.constData(), data.size(), Z_BEST_SPEED) == Z_OK)
+                && (length < (uLongf)data.size()))
+        {
+            encoding = EncodingShuffleDeflate;
+            payload = deflated.constData();
+        }
+        else
+            length = data.size();
+
+        QJsonArray chunk;
+        chunk.append((double)offset);
+        chunk.append((double)length);
+        chunk.append((int)encoding);
+        chunk.append(table.minimum[i]);
+        chunk.append(table.maximum[i]);
+        chunks.append(chunk);
+        write(payload, length);
+        data.resize(0);
+    }
+
+    QJsonObject group;
+    group["rows"] = table.rows;
+    if(table.sequential)
+        group["message"] = (double)table.firstMessage;
+    group["chunks"] = chunks;
+    table.groups.append(group);
+    table.totalRows += table.rows;
+    table.rows = 0;
+}
+
+bool ColumnWriter::close()
+{
+    if(!file.isOpen())
+        return false;
+    QJsonArray tables;
+    QList<Table *> all;
+    all << &motor << &spot;
+    foreach(Table *table, all)
+    {
+        writeGroup(*table);
+        QJsonArray columns;
+        for(int i=0;i<table->names.size();i++)
+        {
+            QJsonObject column;
+            column["name"] = table->names[i];
+            column["type"] = typeName(table->types[i]);
+            columns.append(column);
+        }
+        QJsonObject json;
+        json["name"] = table->name;
+        json["rows"] = (double)table->totalRows;
+        json["columns"] = columns;
+        json["groups"] = table->groups;
+        tables.append(json);
+    }
+
+    QJsonObject footer;
+    footer["version"] = COLUMN_FILE_VERSION;
+    footer["frequency"] = (double)freq;
+    footer["tables"] = tables;
+    QByteArray text = QJsonDocument(footer).toJson(QJsonDocument::Compact);
+    quint32 length = text.size();
+    uchar le[4] = {(uchar)length, (uchar)(length >> 8), (uchar)(length >> 16), (uchar)(length >> 24)};
+    write(text.constData(), text.size());
+    write((const char *)le, 4);
+    write(COLUMN_FILE_MAGIC, 8);
+    file.close();
+    return !failed;
+}
@@ -0,0 +1,82 @@
+#ifndef COLUMNWRITER_H
+#define COLUMNWRITER_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QJsonArray>
+
+#define COLUMN_FILE_MAGIC "LDCOL001"
+#define COLUMN_FILE_VERSION 1
+#define COLUMN_GROUP_ROWS (64*1024)  //motor data rows per row group
+#define COLUMN_SPOT_GROUP_ROWS 4096  //spot value rows per row group
+
+enum ColumnType : quint8
+{
+    ColumnInt32,   //raw field values with no scaling
+    ColumnInt64,   //message numbers
+    ColumnFloat64
+};
+
+enum ColumnEncoding : quint8
+{
+    EncodingPlain,         //little endian values
+    EncodingShuffleDeflate //byte planes (every value's first byte, then every second byte...) in a zlib stream
+};
+
+//Writes the columnar output file (.ldc).  The file is the 8 byte magic, then the column chunks
+//of every row group back to back, then a JSON footer followed by its length (32 bit little
+//endian) and the magic again, so a reader finds the footer from the end of the file and can
+//map the file and go straight to the chunks it wants.  The footer has the frequency and, for
+//each table ("motor" then "spot"), the column names and types and one entry per row group
+//with its rows and for every column [offset, bytes, encoding, min, max].  Motor row groups
+//also have the message number of their first row (rows are consecutive messages, time is
+//floor(message*1000000/frequency) microseconds), spot rows carry their own message column.
+class ColumnWriter
+{
+public:
+    ColumnWriter(const QString &fileName, uint32_t freq);
+
+    void setMotorColumns(const QStringList &names, const QVector<ColumnType> &types);
+    void setSpotColumns(const QStringList &names);
+    bool open();
+    void addMotorRows(quint64 firstMessage, const double *columns, int rows);
+    void addSpotRows(const double *columns, int rows);
+    int spotColumnCount() const { return spot.names.size(); }
+    bool close();
+
+private:
+    struct Table
+    {
+        QString name;
+        QStringList names;
+        QVector<ColumnType> types;
+        int groupRows;
+        bool sequential;         //rows are consecutive messages from firstMessage
+        QVector<QByteArray> data; //current row group, one per column
+        QVector<double> minimum;
+        QVector<double> maximum;
+        int rows;
+        quint64 firstMessage;
+        quint64 totalRows;
+        QJsonArray groups;
+    };
+
+    void setColumns(Table &table, const QStringList &names, const QVector<ColumnType> &types);
+    void addRows(Table &table, quint64 firstMessage, const double *columns, int rows);
+    void writeGroup(Table &table);
+    bool write(const char *data, qint64 size);
+
+    QFile file;
+    uint32_t freq;
+    Table motor;
+    Table spot;
+    QByteArray shuffled;
+    QByteArray deflated;
+    quint64 offset;
+    bool failed;
+};
+
+#endif // COLUMNWRITER_H
@@ -0,0 +1,244 @@
+#include "compressedfile.h"
+
+#include <QStringList>
+#include <zlib.h>
+#ifdef COMPRESS_ZSTD
+#include <zstd.h>
+#endif
+
+//--compress value, gzip or zstd with an optional :level
+bool parseCompression(const QString &text, CompressionFormat &format, int &level)
+{
+    QStringList parts = text.split(':');
+    if(parts.size() > 2)
+        return false;
+    int lowest, highest;
+    if(parts[0] == "gzip")
+    {
+        format = CompressGzip;
+        level = Z_DEFAULT_COMPRESSION;
+        lowest = 1;
+        highest = 9;
+    }
+#ifdef COMPRESS_ZSTD
+    else if(parts[0] == "zstd")
+    {
+        format = CompressZstd;
+        level = 3;
+        lowest = 1;
+        highest = ZSTD_maxCLevel();
+    }
+#endif
+    else
+        return false;
+
+    if(parts.size() == 2)
+    {
+        bool ok;
+        level = parts[1].toInt(&ok);
+        if(!ok || (level < lowest) || (level > highest))
+            return false;
+    }
+    return true;
+}
+
+QString compressionSuffix(CompressionFormat format)
+{
+    switch(format)
+    {
+    case CompressGzip:
+        return ".gz";
+    case CompressZstd:
+        return ".zst";
+    default:
+        return QString();
+    }
+}
+
+bool compressBlock(CompressBlock &block)
+{
+    if(block.format == CompressGzip)
+    {
+        z_stream stream = {};
+        if(deflateInit2(&stream, block.level, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+        block.compressed.resize(deflateBound(&stream, block.data.size()));
+        stream.next_in = (Bytef *)block.data.constData();
+        stream.avail_in = block.data.size();
+        stream.next_out = (Bytef *)block.compressed.data();
+        stream.avail_out = block.compressed.size();
+        bool done = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+        block.compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        return done;
+    }
+#ifdef COMPRESS_ZSTD
+    if(block.format == CompressZstd)
+    {
+        block.compressed.resize(ZSTD_compressBound(block.data.size()));
+        size_t size = ZSTD_compress(block.compressed.data(), block.compressed.size(), block.data.constData(), block.data.size(), block.level);
+        if(ZSTD_isError(size))
+            return false;
+        block.compressed.resize(size);
+        return true;
+    }
+#endif
+    return false;
+}
+
+CompressionPool::CompressionPool(int threads) :
+    stopping(false)
+{
+    for(int i=0;(threads > 1) && (i<threads);i++)
+    {
+        workers.emplace_back([this]()
+        {
+            std::unique_lock<std::mutex> locker(lock);
+            while(true)
+            {
+                changed.wait(locker, [this]() { return stopping || !waiting.empty(); });
+                if(waiting.empty())
+                    break;
+                QSharedPointer<CompressBlock> block = waiting.front();
+                waiting.pop_front();
+                locker.unlock();
+                block->ok = compressBlock(*block);
+                block->data = QByteArray();
+                locker.lock();
+                block->done = true;
+                changed.notify_all();
+            }
+        });
+    }
+}
+
+CompressionPool::~CompressionPool()
+{
+    {
+        std::lock_guard<std::mutex> locker(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    for(std::thread &worker : workers)
+        worker.join();
+}
+
+void CompressionPool::submit(const QSharedPointer<CompressBlock> &block)
+{
+    std::lock_guard<std::mutex> locker(lock);
+    waiting.push_back(block);
+    changed.notify_all();
+}
+
+void CompressionPool::wait(const QSharedPointer<CompressBlock> &block)
+{
+    std::unique_lock<std::mutex> locker(lock);
+    changed.wait(locker, [&]() { return block->done; });
+}
+
+bool CompressionPool::isDone(const QSharedPointer<CompressBlock> &block)
+{
+    std::lock_guard<std::mutex> locker(lock);
+    return block->done;
+}
+
+CompressedFile::CompressedFile(QIODevice *file, CompressionFormat format, int level, CompressionPool *pool) :
+    file(file),
+    format(format),
+    level(level),
+    pool(pool),
+    ok(true)
+{
+    if((pool != nullptr) && (pool->threadCount() == 0))
+        this->pool = nullptr;
+}
+
+CompressedFile::~CompressedFile()
+{
+    finish();
+}
+
+//the file has to be open already
+bool CompressedFile::open(OpenMode mode)
+{
+    if(!file->isOpen() || !(mode & WriteOnly))
+        return false;
+    return QIODevice::open(mode);
+}
+
+void CompressedFile::close()
+{
+    finish();
+    QIODevice::close();
+}
+
+//hand the data written so far to the pool (or compress it here with no pool)
+void CompressedFile::submit()
+{
+    QSharedPointer<CompressBlock> block(new CompressBlock);
+    block->data = pending;
+    block->format = format;
+    block->level = level;
+    block->done = false;
+    block->ok = false;
+    pending = QByteArray();
+    blocks.push_back(block);
+    if(pool == nullptr)
+    {
+        block->ok = compressBlock(*block);
+        block->done = true;
+    }
+    else
+        pool->submit(block);
+}
+
+//write the finished blocks at the front, waiting for them until no more than keep are left
+void CompressedFile::writeBlocks(size_t keep)
+{
+    while(!blocks.empty())
+    {
+        QSharedPointer<CompressBlock> block = blocks.front();
+        if(pool != nullptr)
+        {
+            if(blocks.size() > keep)
+                pool->wait(block);
+            else if(!pool->isDone(block))
+                break;
+        }
+        blocks.pop_front();
+        ok &= block->ok && (file->write(block->compressed) == block->compressed.size());
+    }
+}
+
+qint64 CompressedFile::writeData(const char *data, qint64 size)
+{
+    qint64 left = size;
+    while(left > 0)
+    {
+        qint64 length = qMin<qint64>(left, COMPRESS_BLOCK_BYTES - pending.size());
+        pending.append(data, length);
+        data += length;
+        left -= length;
+        if(pending.size() == COMPRESS_BLOCK_BYTES)
+        {
+            submit();
+            writeBlocks((pool == nullptr) ? 0 : pool->threadCount()*COMPRESS_BLOCKS_PER_THREAD);
+        }
+    }
+    return ok ? size : -1;
+}
+
+bool CompressedFile::flush()
+{
+    if(!pending.isEmpty())
+        submit();
+    writeBlocks(0);
+    return ok;
+}
+
+bool CompressedFile::finish()
+{
+    if(isOpen())
+        flush();
+    return ok;
+}
@@ -0,0 +1,98 @@
+#ifndef COMPRESSEDFILE_H
+#define COMPRESSEDFILE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QSharedPointer>
+#include <QString>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define COMPRESS_BLOCK_BYTES (1024*1024)
+#define COMPRESS_BLOCKS_PER_THREAD 2 //blocks compressed ahead of the one being written, per thread
+
+enum CompressionFormat
+{
+    CompressNone,
+    CompressGzip,
+    CompressZstd  //only if built with CONFIG+=zstd (COMPRESS_ZSTD)
+};
+
+bool parseCompression(const QString &text, CompressionFormat &format, int &level);
+QString compressionSuffix(CompressionFormat format);
+
+//a block of data and what it compresses to, filled in by compressBlock()
+struct CompressBlock
+{
+    QByteArray data;
+    QByteArray compressed;
+    CompressionFormat format;
+    int level;
+    bool done;
+    bool ok;
+};
+
+bool compressBlock(CompressBlock &block);
+
+//Threads that compress blocks for any number of CompressedFiles, so that all the compressed
+//outputs of a decode share the one --threads budget rather than each having a pool of its own.
+//With fewer than two threads there are no workers and the files compress on their own thread.
+class CompressionPool
+{
+public:
+    explicit CompressionPool(int threads);
+    ~CompressionPool();
+
+    int threadCount() const { return (int)workers.size(); }
+
+    void submit(const QSharedPointer<CompressBlock> &block);
+    void wait(const QSharedPointer<CompressBlock> &block);
+    bool isDone(const QSharedPointer<CompressBlock> &block);
+
+private:
+    std::deque<QSharedPointer<CompressBlock> > waiting; //not picked up by a worker yet
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable changed;
+    bool stopping;
+};
+
+//Compresses everything written to it on the way to another device, pigz/zstdmt style: the
+//data is cut into COMPRESS_BLOCK_BYTES blocks that are compressed independently on a pool of
+//threads, and each is written in order as a complete gzip member or zstd frame.  gunzip and
+//zstd read a run of those as one stream.  flush() ends the block being filled early so that
+//everything written so far can be read back.  Without a pool (or with a pool of no threads)
+//the blocks are compressed as they fill, on the writing thread.  The pool has to outlive the
+//file.
+class CompressedFile : public QIODevice
+{
+public:
+    CompressedFile(QIODevice *file, CompressionFormat format, int level, CompressionPool *pool = nullptr);
+    ~CompressedFile();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool flush();
+    bool finish(); //write everything out, false if anything failed
+
+protected:
+    qint64 readData(char *, qint64) override { return -1; }
+    qint64 writeData(const char *data, qint64 size) override;
+
+private:
+    void submit();
+    void writeBlocks(size_t keep);
+
+    QIODevice *file;
+    CompressionFormat format;
+    int level;
+    CompressionPool *pool;
+    QByteArray pending;
+    std::deque<QSharedPointer<CompressBlock> > blocks; //submitted, in file order
+    bool ok;
+};
+
+#endif // COMPRESSEDFILE_H
@@ -0,0 +1,148 @@
+#include "csvwriter.h"
+
+#include <charconv>
+#include <cstring>
+
+#define CSV_MAX_FIELD 64 //longest single field to_chars can produce, with room for the separator
+
+CsvWriter::CsvWriter(QIODevice *device) :
+    device(device),
+    out(&buffer)
+{
+    buffer.resize(CSV_BUFFER_SIZE);
+    setPos(0);
+}
+
+//rows are appended to whatever target already holds, it is trimmed to length on flush()
+CsvWriter::CsvWriter(QByteArray *target) :
+    device(nullptr),
+    out(target)
+{
+    qint64 used = target->size();
+    target->resize(used + CSV_BUFFER_SIZE);
+    setPos(used);
+}
+
+CsvWriter::~CsvWriter()
+{
+    flush();
+}
+
+void CsvWriter::setPos(qint64 used)
+{
+    pos = out->data() + used;
+    limit = out->data() + out->size() - CSV_MAX_FIELD;
+}
+
+//called when the buffer is nearly full, either write it out or grow the target
+void CsvWriter::makeRoom()
+{
+    if(out == &buffer)
+        flush();
+    else
+    {
+        qint64 used = pos - out->constData();
+        out->resize(used*2 + CSV_BUFFER_SIZE);
+        setPos(used);
+    }
+}
+
+void CsvWriter::addText(const QString &text)
+{
+    QByteArray bytes = text.toUtf8();
+    if(bytes.size() >= (limit - pos))
+    {
+        makeRoom();
+        if((out != &buffer) && (bytes.size() >= (limit - pos)))
+        { //make the target big enough
+            qint64 used = pos - out->constData();
+            out->resize(used + bytes.size() + CSV_BUFFER_SIZE);
+            setPos(used);
+        }
+        else if(bytes.size() >= (limit - pos))
+        { //too big to buffer (only likely for a very long name), write it straight out
+            if((device != nullptr) && device->isOpen())
+                device->write(bytes);
+            *pos++ = ',';
+            return;
+        }
+    }
+    memcpy(pos, bytes.constData(), bytes.size());
+    pos += bytes.size();
+    *pos++ = ',';
+    if(pos >= limit)
+        makeRoom();
+}
+
+//seconds with microsecond resolution, built from integers rather than printing a double
+void CsvWriter::addTime(quint64 micros)
+{
+    pos = std::to_chars(pos, pos + CSV_MAX_FIELD, micros/1000000).ptr;
+    uint32_t fraction = micros%1000000;
+    *pos++ = '.';
+    for(int i=5;i>=0;i--)
+    {
+        pos[i] = '0' + (fraction%10);
+        fraction /= 10;
+    }
+    pos += 6;
+    *pos++ = ',';
+    if(pos >= limit)
+        makeRoom();
+}
+
+void CsvWriter::addValue(double value, int precision)
+{
+    if(precision > 0)
+        pos = std::to_chars(pos, pos + CSV_MAX_FIELD, value, std::chars_format::general, precision).ptr;
+    else
+        pos = std::to_chars(pos, pos + CSV_MAX_FIELD, value).ptr;
+    *pos++ = ',';
+    if(pos >= limit)
+        makeRoom();
+}
+
+//write out what has been buffered, or for a byte array target trim it to the formatted length
+bool CsvWriter::flush()
+{
+    qint64 bytes = pos - out->constData();
+    if(out != &buffer)
+    {
+        out->resize(bytes);
+        limit = pos = out->data() + bytes; //nothing more can be added after this
+        return true;
+    }
+    pos = buffer.data();
+    if((bytes == 0) || (device == nullptr) || !device->isOpen())
+        return true;
+    return device->write(buffer.constData(), bytes) == bytes;
+}
+
+//precision option is a comma separated list of significant digit counts, either a bare count
+//which applies to all columns or name=count for a single column, 0 meaning shortest round trip
+bool CsvPrecision::parse(const QString &option)
+{
+    if(option.isEmpty())
+        return true;
+
+    foreach(const QString &item, option.split(','))
+    {
+        QString name;
+        QString digits = item.trimmed();
+        int split = digits.indexOf('=');
+        if(split >= 0)
+        {
+            name = digits.left(split).trimmed();
+            digits = digits.mid(split+1).trimmed();
+        }
+        bool ok;
+        int value = digits.toInt(&ok);
+        if(!ok || (value < 0) || (value > 17))
+            return false;
+        if(name.isEmpty())
+            defaultDigits = value;
+        else
+            columnDigits.insert(name, value);
+    }
+    return true;
+}
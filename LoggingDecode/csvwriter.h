@@ -0,0 +1,98 @@
+#ifndef CSVWRITER_H
+#define CSVWRITER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+
+#define CSV_BUFFER_SIZE (1024*1024)
+#define CSV_DEFAULT_PRECISION 6
+
+//Formats CSV rows straight into a large reusable buffer and hands it to the device in big
+//blocks, or appends them to a byte array that grows as needed.  Values are written with
+//std::to_chars, either to a number of significant digits or (precision 0) as the shortest
+//text that reads back to the same double.
+class CsvWriter
+{
+public:
+    explicit CsvWriter(QIODevice *device);
+    explicit CsvWriter(QByteArray *target);
+    ~CsvWriter();
+
+    void addText(const QString &text);
+    void addTime(quint64 micros);
+    void addValue(double value, int precision = CSV_DEFAULT_PRECISION);
+    void endRow()
+    {
+        *pos++ = '\n';
+        if(pos >= limit)
+            makeRoom();
+    }
+    bool flush();
+
+private:
+    void makeRoom();
+    void setPos(qint64 used);
+
+    QIODevice *device;
+    QByteArray buffer;
+    QByteArray *out; //buffer, or the target when formatting into a byte array
+    char *pos;
+    char *limit;
+};
+
+//Time of each message stepped on in whole microseconds plus a remainder, so the time column
+//never drifts the way an accumulated 1/freq double does
+class MessageClock
+{
+public:
+    explicit MessageClock(uint32_t freq) :
+        freq(freq),
+        stepMicros(1000000/freq),
+        stepRemainder(1000000%freq),
+        now(0),
+        remainder(0)
+    {
+    }
+
+    quint64 micros() const { return now; }
+    void seek(quint64 message)
+    { //same as ticking message times from zero
+        now = (message*1000000)/freq;
+        remainder = (message*1000000)%freq;
+    }
+    void tick()
+    {
+        now += stepMicros;
+        remainder += stepRemainder;
+        if(remainder >= freq)
+        {
+            remainder -= freq;
+            now++;
+        }
+    }
+
+private:
+    uint32_t freq;
+    uint32_t stepMicros;
+    uint32_t stepRemainder;
+    quint64 now;
+    uint32_t remainder;
+};
+
+//significant digits per column from the --precision option
+struct CsvPrecision
+{
+    CsvPrecision() : defaultDigits(CSV_DEFAULT_PRECISION) {}
+
+    bool parse(const QString &option);
+    int digits(const QString &column) const { return columnDigits.value(column, defaultDigits); }
+
+    int defaultDigits;
+    QMap<QString, int> columnDigits;
+};
+
+#endif // CSVWRITER_H
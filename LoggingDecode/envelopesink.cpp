@@ -0,0 +1,261 @@
+#include "envelopesink.h"
+
+#include <cstring>
+
+//--envelope value, increasing factors each a multiple of the one before
+bool parseEnvelopeFactors(const QString &text, QVector<int> &factors)
+{
+    factors.clear();
+    foreach(const QString &part, text.split(','))
+    {
+        bool ok;
+        int factor = part.trimmed().toInt(&ok);
+        if(!ok || (factor < 2) || (!factors.isEmpty() && ((factor <= factors.last()) || (factor%factors.last() != 0))))
+            return false;
+        factors.append(factor);
+    }
+    return true;
+}
+
+//each batch is its first message and how many of each part there are, then the rows before the
+//first whole bin a column at a time, min/max/sum of each column for each whole bin and the rows
+//after the last whole bin
+struct EnvelopeBlockHeader
+{
+    quint64 firstMessage;
+    qint32 leadRows;
+    qint32 bins;
+    qint32 tailRows;
+    qint32 unused;
+};
+
+EnvelopeSink::EnvelopeSink(const QString &baseName, uint32_t freq, const QStringList &names, const QVector<int> &columns, const QVector<int> &digits, const QVector<int> &factors) :
+    baseName(baseName),
+    freq(freq),
+    names(names),
+    columns(columns),
+    digits(digits)
+{
+    for(int i=0;i<factors.size();i++)
+    {
+        QSharedPointer<Level> level(new Level);
+        level->factor = factors[i];
+        level->ratio = (i == 0) ? 1 : factors[i]/factors[i - 1];
+        level->bin = 0;
+        level->count = 0;
+        level->min.resize(columns.size());
+        level->max.resize(columns.size());
+        level->sum.resize(columns.size());
+        levels.append(level);
+    }
+}
+
+bool EnvelopeSink::open(bool pulseView, bool compress)
+{
+    bool ok = true;
+    foreach(const QSharedPointer<Level> &level, levels)
+    {
+        QString name = baseName + "_envelope" + QString::number(level->factor);
+        level->file.setFileName(name + ".csv");
+        if(!level->file.open(QFile::WriteOnly))
+        {
+            ok = false;
+            continue;
+        }
+        level->csv.reset(new CsvWriter(&level->file));
+        level->csv->addText("Time(s)");
+        level->csv->addText("Count");
+        foreach(const QString &channel, names)
+        {
+            level->csv->addText(channel + " min");
+            level->csv->addText(channel + " max");
+            level->csv->addText(channel + " mean");
+        }
+        level->csv->endRow();
+
+        if(pulseView && (level == levels.first()))
+        {
+            QStringList channels;
+            foreach(const QString &channel, names)
+                channels << channel + "_min" << channel + "_max";
+            uint32_t rate = qMax(qRound((double)freq/level->factor), 1);
+            level->sr.reset(new SrWriter(name + ".sr", rate, channels, compress));
+            if(!level->sr->open())
+            {
+                level->sr.reset();
+                ok = false;
+            }
+            samples.resize(channels.size());
+        }
+    }
+    return ok;
+}
+
+void EnvelopeSink::encode(const FrameBatch &batch, QByteArray &block) const
+{
+    int factor = levels.first()->factor;
+    int lead = qMin<quint64>(batch.rows, (factor - batch.firstMessage%factor)%factor);
+    int bins = (batch.rows - lead)/factor;
+    int tail = batch.rows - lead - bins*factor;
+    int start = block.size();
+    block.resize(start + sizeof(EnvelopeBlockHeader) + ((lead + tail) + bins*3)*columns.size()*sizeof(double));
+    EnvelopeBlockHeader *header = (EnvelopeBlockHeader *)(block.data() + start);
+    header->firstMessage = batch.firstMessage;
+    header->leadRows = lead;
+    header->bins = bins;
+    header->tailRows = tail;
+    header->unused = 0;
+
+    double *out = (double *)(header + 1);
+    for(int i=0;i<columns.size();i++,out+=lead)
+        memcpy(out, batch.column(columns[i]), lead*sizeof(double));
+    for(int bin=0;bin<bins;bin++)
+    {
+        for(int i=0;i<columns.size();i++)
+        {
+            const double *in = batch.column(columns[i]) + lead + bin*factor;
+            double min = in[0], max = in[0], sum = in[0];
+            for(int row=1;row<factor;row++)
+            {
+                min = qMin(min, in[row]);
+                max = qMax(max, in[row]);
+                sum += in[row];
+            }
+            *out++ = min;
+            *out++ = max;
+            *out++ = sum;
+        }
+    }
+    for(int i=0;i<columns.size();i++,out+=tail)
+        memcpy(out, batch.column(columns[i]) + batch.rows - tail, tail*sizeof(double));
+}
+
+//rows of finest bins split between batches, a column at a time
+void EnvelopeSink::addRows(const double *values, int rows, quint64 firstMessage)
+{
+    QVector<double> row(columns.size());
+    for(int i=0;i<rows;i++)
+    {
+        for(int j=0;j<columns.size();j++)
+            row[j] = values[j*rows + i];
+        accumulate(0, (firstMessage + i)/levels.first()->factor, 1, row.constData(), row.constData(), row.constData());
+    }
+}
+
+bool EnvelopeSink::append(const QByteArray &block)
+{
+    const char *in = block.constData();
+    const char *end = in + block.size();
+    int factor = levels.first()->factor;
+    QVector<double> min(columns.size()), max(columns.size()), sum(columns.size());
+    while(in + sizeof(EnvelopeBlockHeader) <= end)
+    {
+        const EnvelopeBlockHeader *header = (const EnvelopeBlockHeader *)in;
+        const double *values = (const double *)(header + 1);
+        addRows(values, header->leadRows, header->firstMessage);
+        values += header->leadRows*columns.size();
+
+        quint64 bin = (header->firstMessage + header->leadRows)/factor;
+        for(int i=0;i<header->bins;i++,bin++)
+        {
+            for(int j=0;j<columns.size();j++)
+            {
+                min[j] = *values++;
+                max[j] = *values++;
+                sum[j] = *values++;
+            }
+            accumulate(0, bin, factor, min.constData(), max.constData(), sum.constData());
+        }
+
+        addRows(values, header->tailRows, bin*factor);
+        values += header->tailRows*columns.size();
+        in = (const char *)values;
+    }
+    return true;
+}
+
+//add to a level's bin, writing out the one before if this is a new bin
+void EnvelopeSink::accumulate(int index, quint64 bin, quint64 count, const double *min, const double *max, const double *sum)
+{
+    Level &level = *levels[index];
+    if((level.count > 0) && (level.bin != bin))
+        writeBin(index);
+    if(level.count == 0)
+    {
+        level.bin = bin;
+        for(int i=0;i<columns.size();i++)
+        {
+            level.min[i] = min[i];
+            level.max[i] = max[i];
+            level.sum[i] = sum[i];
+        }
+    }
+    else
+    {
+        for(int i=0;i<columns.size();i++)
+        {
+            level.min[i] = qMin(level.min[i], min[i]);
+            level.max[i] = qMax(level.max[i], max[i]);
+            level.sum[i] += sum[i];
+        }
+    }
+    level.count += count;
+}
+
+//write out a level's bin and add it to the level above
+void EnvelopeSink::writeBin(int index)
+{
+    Level &level = *levels[index];
+    if(level.count == 0)
+        return;
+    if(!level.csv.isNull())
+    {
+        MessageClock clock(freq);
+        clock.seek(level.bin*level.factor);
+        level.csv->addTime(clock.micros());
+        level.csv->addValue(level.count, 0);
+        for(int i=0;i<columns.size();i++)
+        {
+            level.csv->addValue(level.min[i], digits[i]);
+            level.csv->addValue(level.max[i], digits[i]);
+            level.csv->addValue(level.sum[i]/level.count, digits[i]);
+        }
+        level.csv->endRow();
+    }
+    if(!level.sr.isNull())
+    {
+        for(int i=0;i<columns.size();i++)
+        {
+            samples[i*2] = level.min[i];
+            samples[i*2 + 1] = level.max[i];
+        }
+        level.sr->addChannels(samples.constData(), 1);
+    }
+
+    quint64 count = level.count;
+    level.count = 0;
+    if(index + 1 < levels.size())
+        accumulate(index + 1, level.bin/levels[index + 1]->ratio, count, level.min.constData(), level.max.constData(), level.sum.constData());
+}
+
+bool EnvelopeSink::finish()
+{
+    bool ok = true;
+    for(int i=0;i<levels.size();i++)
+    {
+        Level &level = *levels[i];
+        writeBin(i);
+        if(!level.csv.isNull())
+        {
+            ok &= level.csv->flush();
+            level.csv.reset();
+            level.file.close();
+        }
+        if(!level.sr.isNull())
+        {
+            ok &= level.sr->close();
+            level.sr.reset();
+        }
+    }
+    return ok;
+}
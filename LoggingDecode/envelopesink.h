@@ -0,0 +1,64 @@
+#ifndef ENVELOPESINK_H
+#define ENVELOPESINK_H
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "framesinks.h"
+
+#define ENVELOPE_DEFAULT_FACTORS "16,256,4096"
+
+bool parseEnvelopeFactors(const QString &text, QVector<int> &factors);
+
+//Min/max/mean envelopes of the motor data at a few decimation levels, for --envelope.  Level
+//n has a bin for every factor[n] messages counted from the start of the log, written as a row
+//of [dest]_envelope<factor>.csv, and each level is built from the bins of the one below it so
+//the data is only gone through once.  encode() works out the whole finest bins in a batch and
+//passes the rows of any bin split between batches through as they are, append() adds those up
+//in message order, so the envelopes don't depend on how the log was split up.  The finest
+//level can also be written as a reduced rate PulseView file with a min and max channel for
+//each motor channel.
+class EnvelopeSink : public FrameSink
+{
+public:
+    EnvelopeSink(const QString &baseName, uint32_t freq, const QStringList &names, const QVector<int> &columns, const QVector<int> &digits, const QVector<int> &factors);
+
+    bool open(bool pulseView, bool compress);
+
+    void encode(const FrameBatch &batch, QByteArray &block) const override;
+    bool append(const QByteArray &block) override;
+    bool finish() override;
+
+private:
+    struct Level
+    {
+        int factor;
+        int ratio; //bins of the level below in each of these
+        QFile file;
+        QScopedPointer<CsvWriter> csv;
+        QScopedPointer<SrWriter> sr;
+        quint64 bin; //the bin being filled
+        quint64 count;
+        QVector<double> min;
+        QVector<double> max;
+        QVector<double> sum;
+    };
+
+    void addRows(const double *values, int rows, quint64 firstMessage);
+    void accumulate(int level, quint64 bin, quint64 count, const double *min, const double *max, const double *sum);
+    void writeBin(int level);
+
+    QString baseName;
+    uint32_t freq;
+    QStringList names;
+    QVector<int> columns;
+    QVector<int> digits;
+    QVector<QSharedPointer<Level> > levels;
+    QVector<float> samples; //min and max of each channel, for the PulseView file
+};
+
+#endif // ENVELOPESINK_H
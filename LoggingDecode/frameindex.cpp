@@ -0,0 +1,120 @@
+#include "frameindex.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "chunkdecoder.h"
+
+FrameIndex::FrameIndex() :
+    messageCount(0)
+{
+}
+
+//read the index for a log, false if there isn't one or it doesn't match the log as it is now
+bool FrameIndex::load(const QString &logFileName, qint64 dataStart, int messageBytes, const QString &indexFileName)
+{
+    entries.clear();
+    messageCount = 0;
+
+    QFile file(indexFileName.isEmpty() ? fileNameFor(logFileName) : indexFileName);
+    if(!file.open(QFile::ReadOnly))
+        return false;
+    QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+    QFileInfo log(logFileName);
+    if((json["version"].toInt() != FRAME_INDEX_VERSION)
+            || ((qint64)json["logSize"].toDouble() != log.size())
+            || ((qint64)json["logModified"].toDouble() != log.lastModified().toMSecsSinceEpoch())
+            || ((qint64)json["dataStart"].toDouble() != dataStart)
+            || (json["messageBytes"].toInt() != messageBytes))
+        return false;
+
+    QJsonArray list = json["entries"].toArray();
+    entries.reserve(list.size());
+    for(int i=0;i<list.size();i++)
+    {
+        QJsonArray item = list[i].toArray();
+        FrameIndexEntry entry = {(quint64)item[0].toDouble(), (qint64)item[1].toDouble()};
+        entries.append(entry);
+    }
+    messageCount = (quint64)json["messages"].toDouble();
+    return true;
+}
+
+bool FrameIndex::save(const QString &logFileName, qint64 dataStart, int messageBytes, const QString &indexFileName) const
+{
+    QFileInfo log(logFileName);
+    QJsonObject json;
+    json["version"] = FRAME_INDEX_VERSION;
+    json["logSize"] = (double)log.size();
+    json["logModified"] = (double)log.lastModified().toMSecsSinceEpoch();
+    json["dataStart"] = (double)dataStart;
+    json["messageBytes"] = messageBytes;
+    json["messages"] = (double)messageCount;
+    QJsonArray list;
+    foreach(const FrameIndexEntry &entry, entries)
+    {
+        QJsonArray item;
+        item.append((double)entry.message);
+        item.append((double)entry.offset);
+        list.append(item);
+    }
+    json["entries"] = list;
+
+    QFile file(indexFileName.isEmpty() ? fileNameFor(logFileName) : indexFileName);
+    if(!file.open(QFile::WriteOnly))
+        return false;
+    QByteArray text = QJsonDocument(json).toJson(QJsonDocument::Compact);
+    return file.write(text) == text.size();
+}
+
+//last entry before a message (so the spot value set completed on that message is rebuilt too),
+//null if the message is in the first cycle and has to be read from the start of the data
+const FrameIndexEntry *FrameIndex::before(quint64 message) const
+{
+    const FrameIndexEntry *found = nullptr;
+    int low = 0;
+    int high = entries.size();
+    while(low < high)
+    {
+        int mid = (low + high)/2;
+        if(entries[mid].message < message)
+        {
+            found = &entries[mid];
+            low = mid + 1;
+        }
+        else
+            high = mid;
+    }
+    return found;
+}
+
+//read through the log recording index entries without decoding, in chunks on all threads when it's mapped
+bool FrameIndex::build(const QString &logFileName, qint64 dataStart, const DecodePlan &plan, int threads, QVector<FrameIndexEntry> &entries, quint64 &messages)
+{
+    ChunkedDecoder chunked(logFileName, dataStart, plan, QMap<uint32_t, QString>(), 0); //only split, so no spot values or clock
+    if(chunked.split(threads))
+    {
+        entries = chunked.indexEntries();
+        messages = chunked.messages();
+        return true;
+    }
+
+    LogSource source(logFileName);
+    if(!source.open() || !source.seek(dataStart))
+        return false;
+    FrameReader reader(source, plan);
+    QStringList discard;
+    reader.setMessageLog(&discard);
+    reader.start(dataStart, false);
+    entries.clear();
+    reader.setIndex(&entries);
+    MessageBlock block;
+    while(reader.read(block) > 0)
+        ;
+    messages = reader.messageNumber();
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef FRAMEINDEX_H
+#define FRAMEINDEX_H
+
+#include <QString>
+#include <QVector>
+
+#include "decodeplan.h"
+#include "framereader.h"
+
+#define FRAME_INDEX_VERSION 1
+
+//Sparse sidecar index ([log].idx, or another file named by the caller) from message number to
+//file offset.  Every entry is a point
+//a reader can start from already in sync, and as the spot values restart there the spot state
+//can be rebuilt from it too.  The index records the size and modification time of the log it
+//was made from and is ignored if either has changed.
+class FrameIndex
+{
+public:
+    FrameIndex();
+
+    static QString fileNameFor(const QString &logFileName) { return logFileName + ".idx"; }
+
+    //indexFileName empty for the usual fileNameFor(logFileName)
+    bool load(const QString &logFileName, qint64 dataStart, int messageBytes, const QString &indexFileName = QString());
+    bool save(const QString &logFileName, qint64 dataStart, int messageBytes, const QString &indexFileName = QString()) const;
+    static bool build(const QString &logFileName, qint64 dataStart, const DecodePlan &plan, int threads, QVector<FrameIndexEntry> &entries, quint64 &messages);
+
+    void set(const QVector<FrameIndexEntry> &entries, quint64 messages) { this->entries = entries; messageCount = messages; }
+    bool isEmpty() const { return messageCount == 0; }
+    quint64 messages() const { return messageCount; }
+    const FrameIndexEntry *before(quint64 message) const;
+
+private:
+    QVector<FrameIndexEntry> entries;
+    quint64 messageCount;
+};
+
+#endif // FRAMEINDEX_H
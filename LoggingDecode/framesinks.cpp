@@ -0,0 +1,133 @@
+#include "framesinks.h"
+
+#include <cstring>
+
+static void writeHeader(QIODevice *device, const QStringList &names)
+{
+    CsvWriter csv(device);
+    csv.addText("Time(s)");
+    foreach(const QString &name, names)
+        csv.addText(name);
+    csv.endRow();
+}
+
+MotorCsvSink::MotorCsvSink(QIODevice *device, uint32_t freq, const QStringList &names, const QVector<int> &columns, const QVector<int> &digits) :
+    device(device),
+    freq(freq),
+    columns(columns),
+    digits(digits)
+{
+    writeHeader(device, names);
+}
+
+void MotorCsvSink::encode(const FrameBatch &batch, QByteArray &block) const
+{
+    QVector<const double *> in(columns.size());
+    for(int i=0;i<columns.size();i++)
+        in[i] = batch.column(columns[i]);
+
+    CsvWriter csv(&block);
+    MessageClock clock(freq);
+    clock.seek(batch.firstMessage);
+    for(int row=0;row<batch.rows;row++)
+    {
+        csv.addTime(clock.micros());
+        for(int i=0;i<in.size();i++)
+            csv.addValue(in[i][row], digits[i]);
+        csv.endRow();
+        clock.tick();
+    }
+}
+
+SpotCsvSink::SpotCsvSink(QIODevice *device, uint32_t freq, const QStringList &names, const QVector<int> &digits) :
+    device(device),
+    freq(freq),
+    digits(digits)
+{
+    writeHeader(device, names);
+}
+
+void SpotCsvSink::encode(const FrameBatch &batch, QByteArray &block) const
+{
+    if(batch.spotSets() == 0)
+        return;
+
+    CsvWriter csv(&block);
+    MessageClock clock(freq);
+    for(int set=0;set<batch.spotSets();set++)
+    {
+        clock.seek(batch.firstMessage + batch.spotRows[set]);
+        csv.addTime(clock.micros());
+        const double *values = batch.spotSet(set);
+        for(int i=0;i<batch.spotColumns;i++)
+            csv.addValue(values[i], digits[i]);
+        csv.endRow();
+    }
+}
+
+void SrSink::encode(const FrameBatch &batch, QByteArray &block) const
+{
+    int start = block.size();
+    block.resize(start + batch.rows*columns.size()*sizeof(float));
+    float *out = (float *)(block.data() + start);
+    for(int i=0;i<columns.size();i++)
+    {
+        const double *in = batch.column(columns[i]);
+        for(int row=0;row<batch.rows;row++)
+            *out++ = (float)in[row];
+    }
+}
+
+bool SrSink::append(const QByteArray &block)
+{
+    if(columns.isEmpty())
+        return true;
+    int rows = block.size()/(columns.size()*sizeof(float));
+    return writer.addChannels((const float *)block.constData(), rows);
+}
+
+//each batch is its first message, row and spot set counts, then the motor columns and the spot
+//columns (message number first) a column at a time
+struct ColumnBlockHeader
+{
+    quint64 firstMessage;
+    qint32 rows;
+    qint32 spotSets;
+};
+
+void ColumnSink::encode(const FrameBatch &batch, QByteArray &block) const
+{
+    int sets = batch.spotSets();
+    int start = block.size();
+    block.resize(start + sizeof(ColumnBlockHeader) + (batch.rows*columns.size() + sets*(batch.spotColumns + 1))*sizeof(double));
+    ColumnBlockHeader *header = (ColumnBlockHeader *)(block.data() + start);
+    header->firstMessage = batch.firstMessage;
+    header->rows = batch.rows;
+    header->spotSets = sets;
+
+    double *out = (double *)(header + 1);
+    for(int i=0;i<columns.size();i++,out+=batch.rows)
+        memcpy(out, batch.column(columns[i]), batch.rows*sizeof(double));
+    for(int set=0;set<sets;set++)
+        *out++ = (double)(batch.firstMessage + batch.spotRows[set]);
+    for(int i=0;i<batch.spotColumns;i++)
+        for(int set=0;set<sets;set++)
+            *out++ = batch.spotSet(set)[i];
+}
+
+bool ColumnSink::append(const QByteArray &block)
+{
+    const char *in = block.constData();
+    const char *end = in + block.size();
+    while(in + sizeof(ColumnBlockHeader) <= end)
+    {
+        const ColumnBlockHeader *header = (const ColumnBlockHeader *)in;
+        const double *values = (const double *)(header + 1);
+        writer.addMotorRows(header->firstMessage, values, header->rows);
+        values += header->rows*columns.size();
+        writer.addSpotRows(values, header->spotSets);
+        values += header->spotSets*(writer.spotColumnCount());
+        in = (const char *)values;
+    }
+    return true;
+}
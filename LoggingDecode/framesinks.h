@@ -0,0 +1,108 @@
+#ifndef FRAMESINKS_H
+#define FRAMESINKS_H
+
+#include <QIODevice>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+
+#include "framebatch.h"
+#include "csvwriter.h"
+#include "srwriter.h"
+#include "columnwriter.h"
+
+//An output fed with decoded batches in message order.  Turning a batch into output bytes
+//(encode) is kept apart from adding those bytes to the output (append) so that batches can be
+//encoded on any number of threads while the outputs are still appended in order.
+class FrameSink
+{
+public:
+    FrameSink() : busy(0) {}
+    virtual ~FrameSink() {}
+
+    //format a batch onto the end of block, must be safe to call from several threads at once
+    virtual void encode(const FrameBatch &batch, QByteArray &block) const = 0;
+    //add an encoded block to the output, blocks arrive in message order on one thread
+    virtual bool append(const QByteArray &block) = 0;
+    virtual bool finish() = 0; //push out anything still buffered
+
+    bool write(const FrameBatch &batch)
+    {
+        scratch.resize(0);
+        encode(batch, scratch);
+        return append(scratch);
+    }
+
+    //time spent encoding and appending, added by whoever calls them (from any thread)
+    void addTime(qint64 nanos) { busy += nanos; }
+    qint64 time() const { return busy; }
+
+private:
+    QByteArray scratch;
+    std::atomic<qint64> busy;
+};
+
+//motor data CSV, one row per message
+class MotorCsvSink : public FrameSink
+{
+public:
+    MotorCsvSink(QIODevice *device, uint32_t freq, const QStringList &names, const QVector<int> &columns, const QVector<int> &digits);
+
+    void encode(const FrameBatch &batch, QByteArray &block) const override;
+    bool append(const QByteArray &block) override { return device->write(block) == block.size(); }
+    bool finish() override { return true; }
+
+private:
+    QIODevice *device;
+    uint32_t freq;
+    QVector<int> columns;
+    QVector<int> digits;
+};
+
+//spot value CSV, one row per completed set of spot values
+class SpotCsvSink : public FrameSink
+{
+public:
+    SpotCsvSink(QIODevice *device, uint32_t freq, const QStringList &names, const QVector<int> &digits);
+
+    void encode(const FrameBatch &batch, QByteArray &block) const override;
+    bool append(const QByteArray &block) override { return device->write(block) == block.size(); }
+    bool finish() override { return true; }
+
+private:
+    QIODevice *device;
+    uint32_t freq;
+    QVector<int> digits;
+};
+
+//PulseView channels, encoded as a float array per channel
+class SrSink : public FrameSink
+{
+public:
+    SrSink(SrWriter &writer, const QVector<int> &columns) : writer(writer), columns(columns) {}
+
+    void encode(const FrameBatch &batch, QByteArray &block) const override;
+    bool append(const QByteArray &block) override;
+    bool finish() override { return true; }
+
+private:
+    SrWriter &writer;
+    QVector<int> columns;
+};
+
+//columnar file, motor columns and spot sets copied out of the batch as they are
+class ColumnSink : public FrameSink
+{
+public:
+    ColumnSink(ColumnWriter &writer, const QVector<int> &columns) : writer(writer), columns(columns) {}
+
+    void encode(const FrameBatch &batch, QByteArray &block) const override;
+    bool append(const QByteArray &block) override;
+    bool finish() override { return true; }
+
+private:
+    ColumnWriter &writer;
+    QVector<int> columns;
+};
+
+#endif // FRAMESINKS_H
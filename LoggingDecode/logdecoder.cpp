@@ -0,0 +1,485 @@
+#include "logdecoder.h"
+
+#include <QFile>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <limits>
+
+#include "logheader.h"
+#include "logsource.h"
+#include "chunkdecoder.h"
+#include "columnwriter.h"
+#include "compressedfile.h"
+#include "envelopesink.h"
+#include "frameindex.h"
+#include "logfollower.h"
+#include "pipeline.h"
+#include "signalsummary.h"
+#include "spotassembler.h"
+#include "srwriter.h"
+#include "triggercapture.h"
+
+#define BUFFER_SIZE 25
+
+DecodeOptions::DecodeOptions() :
+    motorPV(false),
+    motorCsv(false),
+    spotCsv(false),
+    json(false),
+    columns(false),
+    srStore(false),
+    threads(1),
+    buildIndex(false),
+    follow(false),
+    idleSeconds(0),
+    compression(CompressNone),
+    compressionLevel(0),
+    triggerPre(TRIGGER_DEFAULT_SECONDS),
+    triggerPost(TRIGGER_DEFAULT_SECONDS),
+    triggerSegments(TRIGGER_DEFAULT_SEGMENTS),
+    envelopeSr(false),
+    summary(false),
+    progressSeconds(PROGRESS_SECONDS),
+    printStats(false)
+{
+}
+
+QSharedPointer<const DecodePlanCache::Entry> DecodePlanCache::find(const QByteArray &format, double modmax, uint32_t maxpwm, const QStringList &derived, const QStringList &fields, const QStringList &decoded)
+{
+    QByteArray key = QByteArray::number(modmax, 'g', 17) + ' ' + QByteArray::number(maxpwm) + ' ' + derived.join(',').toUtf8() + ' ' + fields.join(',').toUtf8() + ' ' + decoded.join(',').toUtf8() + ' ' + format;
+    QMutexLocker locker(&lock);
+    QSharedPointer<const Entry> found = entries.value(key);
+    if(found.isNull())
+    {
+        QSharedPointer<Entry> entry(new Entry);
+        entry->valid = parseLogFormat(format, entry->varDefs, derived, fields, decoded) && entry->plan.build(entry->varDefs, modmax, maxpwm);
+        entries.insert(key, entry);
+        found = entry;
+    }
+    return found;
+}
+
+//message number for a --start/--end value, seconds or a message number with an f suffix,
+//seconds give the first message at or after that time
+static bool parseMessagePosition(const QString &text, uint32_t freq, quint64 &message)
+{
+    bool ok;
+    if(text.endsWith('f'))
+    {
+        message = text.left(text.size() - 1).toULongLong(&ok);
+        return ok;
+    }
+    double seconds = text.toDouble(&ok);
+    if(!ok || (seconds < 0))
+        return false;
+    quint64 micros = qRound64(seconds*1000000);
+    message = (micros*freq + 999999)/1000000;
+    return true;
+}
+
+//decode one log into the outputs asked for, returns false if it couldn't be decoded at all
+bool decodeLog(const QString &inputFileName, const QString &baseOpFileName, const DecodeOptions &options, DecodePlanCache &plans, DecodeStats *stats, const QString &indexFileName)
+{
+    bool triggered = !options.trigger.isEmpty(); //motor CSV and PulseView only around the hits
+    bool genMotPVFile = options.motorPV && !triggered;
+    bool genColumnFile = options.columns;
+    int threads = options.threads;
+    bool follow = options.follow;
+    QElapsedTimer timer;
+    timer.start();
+    DecodeStats ownStats;
+    if(stats == nullptr)
+        stats = &ownStats;
+
+    TriggerExpression trigger;
+    if(triggered && !trigger.parse(options.trigger))
+    {
+        qDebug("Invalid trigger");
+        return false;
+    }
+
+    LogSource logFile(inputFileName);
+    logFile.setFollow(follow);
+    if(!logFile.open())
+    {
+        qDebug("Could not open input file");
+        return false;
+    }
+    qDebug("Processing input file header");
+    stats->logs = 1;
+    stats->bytes = logFile.size();
+
+    LogHeader header;
+    QString headerError;
+    bool headerRead = readLogHeader(logFile, header, headerError);
+    QMap<uint32_t, QString> spotLookup = header.spotLookup;
+    uint32_t freq = header.freq;
+    bool decoded = false;
+
+    QString csvSuffix = ".csv" + compressionSuffix(options.compression);
+    QFile outFileBin(baseOpFileName + "_motor_data" + csvSuffix);
+    QFile outFileSpot(baseOpFileName + "_spot_values" + csvSuffix);
+    QFile summaryJson(baseOpFileName + "_summary.json");
+    QFile summaryCsv(baseOpFileName + "_summary.csv");
+    CompressionPool compressionPool((options.compression != CompressNone) ? threads : 1); //shared by both files
+    CompressedFile motorCompressed(&outFileBin, options.compression, options.compressionLevel, &compressionPool);
+    CompressedFile spotCompressed(&outFileSpot, options.compression, options.compressionLevel, &compressionPool);
+
+//write the parameters to file
+    if(options.json)
+    {
+        QFile paramFile(baseOpFileName + ".json");
+        paramFile.open(QFile::WriteOnly);
+        if(paramFile.isOpen())
+        {
+            paramFile.write(header.parameters);
+            paramFile.close();
+            qDebug("JSON file written");
+        }
+        else
+            qDebug("Could not write JSON file");
+    }
+
+//if we have a complete definition then process it
+    if(headerRead)
+    {
+        QSharedPointer<const DecodePlanCache::Entry> format = plans.find(header.format, header.modmax, header.maxpwm, options.derived, options.fields, trigger.channels());
+        if(!format->valid)
+        {
+            qDebug("Json header message format invalid");
+            return false;
+        }
+        const QVector<varDefinitions> &varDefs = format->varDefs;
+        const DecodePlan &plan = format->plan;
+        stats->stages.nanos[StageHeader] = timer.nsecsElapsed();
+        if(triggered && !trigger.compile(varDefs, plan))
+            return false;
+
+        //every column the log could give, then just the spot values asked for
+        QStringList knownColumns;
+        foreach(const varDefinitions &def, varDefs)
+            if((def.name != "csum") && (def.name != "spot"))
+                knownColumns << def.name;
+        knownColumns << spotLookup.values();
+        foreach(const QString &name, options.fields)
+            if(!knownColumns.contains(name))
+                qDebug("Field %s is not in the log", qPrintable(name));
+        if(!options.spotFields.isEmpty())
+        {
+            foreach(const QString &name, options.spotFields)
+                if(!spotLookup.values().contains(name))
+                    qDebug("Spot value %s is not in the log", qPrintable(name));
+            for(QMap<uint32_t, QString>::iterator it=spotLookup.begin();it!=spotLookup.end();)
+            {
+                if(options.spotFields.contains(it.value()))
+                    ++it;
+                else
+                    it = spotLookup.erase(it);
+            }
+        }
+
+        //the index is only used for a window, but kept up to date whenever the whole log is read
+        qint64 dataStart = header.dataStart;
+        quint64 startMessage = 0;
+        quint64 endMessage = std::numeric_limits<quint64>::max();
+        bool window = !options.start.isEmpty() || !options.end.isEmpty();
+        if((!options.start.isEmpty() && !parseMessagePosition(options.start, freq, startMessage))
+                || (!options.end.isEmpty() && !parseMessagePosition(options.end, freq, endMessage))
+                || (startMessage >= endMessage))
+        {
+            qDebug("Invalid start or end");
+            return false;
+        }
+
+        FrameIndex index;
+        //(a log still being written isn't indexed, it would be out of date straight away)
+        bool indexed = follow || (!options.buildIndex && index.load(inputFileName, dataStart, plan.messageBytes(), indexFileName));
+        if(!indexed && (window || options.buildIndex))
+        {
+            qDebug("Building frame index");
+            QVector<FrameIndexEntry> entries;
+            quint64 messages;
+            if(FrameIndex::build(inputFileName, dataStart, plan, threads, entries, messages))
+            {
+                index.set(entries, messages);
+                indexed = true;
+                if(index.save(inputFileName, dataStart, plan.messageBytes(), indexFileName))
+                    qDebug("Index file written");
+                else
+                    qDebug("Could not write index file");
+            }
+            else
+                qDebug("Could not build index");
+        }
+        decoded = true;
+
+//process main data block and write output files
+        //open these first so they are in the app directory
+        if(options.motorCsv && !triggered)
+            outFileBin.open(QFile::WriteOnly);
+        if(options.spotCsv)
+            outFileSpot.open(QFile::WriteOnly);
+        if((options.compression != CompressNone) && outFileBin.isOpen())
+            motorCompressed.open(QIODevice::WriteOnly);
+        if((options.compression != CompressNone) && outFileSpot.isOpen())
+            spotCompressed.open(QIODevice::WriteOnly);
+        if(options.summary && (!summaryJson.open(QFile::WriteOnly) || !summaryCsv.open(QFile::WriteOnly)))
+        {
+            qDebug("Could not open summary files");
+            summaryJson.close();
+        }
+        QIODevice *motorOut = motorCompressed.isOpen() ? (QIODevice *)&motorCompressed : &outFileBin;
+        QIODevice *spotOut = spotCompressed.isOpen() ? (QIODevice *)&spotCompressed : &outFileSpot;
+
+        QStringList pvChannels;
+        for(int i=0;i<varDefs.size();i++)
+            if(varDefs[i].isOutput)
+                pvChannels << varDefs[i].name;
+        SrWriter pvFile(baseOpFileName + ".sr", freq, pvChannels, !options.srStore);
+        if(genMotPVFile && !pvFile.open())
+        {
+            qDebug("Could not open PulseView file");
+            genMotPVFile = false;
+        }
+
+        QStringList columnNames;
+        QVector<ColumnType> columnTypes;
+        for(int i=0;i<varDefs.size();i++)
+        {
+            if(varDefs[i].isOutput)
+            {
+                columnNames << varDefs[i].name;
+                columnTypes << (plan.isInteger(i) ? ColumnInt32 : ColumnFloat64);
+            }
+        }
+        ColumnWriter columnFile(baseOpFileName + ".ldc", freq);
+        columnFile.setMotorColumns(columnNames, columnTypes);
+        columnFile.setSpotColumns(spotLookup.values());
+        if(genColumnFile && !columnFile.open())
+        {
+            qDebug("Could not open columnar file");
+            genColumnFile = false;
+        }
+
+        if(outFileBin.isOpen() || outFileSpot.isOpen() || genMotPVFile || genColumnFile || summaryJson.isOpen()
+                || (triggered && (options.motorCsv || options.motorPV)) || !options.envelope.isEmpty())
+        {
+            QVector<int> motorColumns, motorDigits, spotDigits;
+            QStringList motorNames;
+
+            for(int i=0;i<varDefs.size();i++)
+            {
+                if(varDefs[i].isOutput)
+                {
+                    motorColumns.append(i);
+                    motorDigits.append(options.precision.digits(varDefs[i].name));
+                    motorNames.append(varDefs[i].name);
+                }
+            }
+            foreach(const QString &name, spotLookup.values())
+                spotDigits.append(options.precision.digits(name));
+            foreach(const QString &name, options.precision.columnDigits.keys())
+                if(!knownColumns.contains(name))
+                    qDebug("Precision given for unknown column %s", qPrintable(name));
+
+            if(plan.messageBytes() <=BUFFER_SIZE)
+            {
+                MotorCsvSink motorCsv(motorOut, freq, motorNames, motorColumns, motorDigits);
+                SpotCsvSink spotCsv(spotOut, freq, spotLookup.values(), spotDigits);
+                SrSink pvSink(pvFile, motorColumns);
+                ColumnSink columnSink(columnFile, motorColumns);
+                TriggerSink triggerSink(trigger, baseOpFileName, freq, plan.valueCount(), qRound(options.triggerPre*freq), qRound(options.triggerPost*freq), options.triggerSegments);
+                if(options.motorCsv)
+                    triggerSink.setMotorCsv(motorNames, motorColumns, motorDigits);
+                if(options.motorPV)
+                    triggerSink.setPulseView(pvChannels, motorColumns, !options.srStore);
+                EnvelopeSink envelopeSink(baseOpFileName, freq, motorNames, motorColumns, motorDigits, options.envelope);
+                SummarySink summarySink(&summaryJson, &summaryCsv, freq, motorNames, motorColumns, spotLookup.values());
+
+                QList<FrameSink *> sinks;
+                QStringList sinkNames;
+                if(outFileBin.isOpen())
+                {
+                    sinks << &motorCsv;
+                    sinkNames << "motor csv";
+                }
+                if(outFileSpot.isOpen())
+                {
+                    sinks << &spotCsv;
+                    sinkNames << "spot csv";
+                }
+                if(genMotPVFile)
+                {
+                    sinks << &pvSink;
+                    sinkNames << "pulseview";
+                }
+                if(genColumnFile)
+                {
+                    sinks << &columnSink;
+                    sinkNames << "columns";
+                }
+                if(triggered && (options.motorCsv || options.motorPV))
+                {
+                    sinks << &triggerSink;
+                    sinkNames << "trigger";
+                }
+                if(!options.envelope.isEmpty())
+                {
+                    if(envelopeSink.open(options.envelopeSr, !options.srStore))
+                    {
+                        sinks << &envelopeSink;
+                        sinkNames << "envelope";
+                    }
+                    else
+                        qDebug("Could not open envelope files");
+                }
+                if(summaryJson.isOpen())
+                {
+                    sinks << &summarySink;
+                    sinkNames << "summary";
+                }
+
+                qDebug("Started processing data");
+                bool written;
+                QVector<FrameIndexEntry> entries;
+                quint64 messages = 0;
+                qint64 lostBytes = 0;
+                int gaps = 0;
+                //a mapped log big enough to be worth it is decoded a chunk per thread, otherwise
+                //(or for a window) it goes through the reader/decoder/writer pipeline
+                ChunkedDecoder chunked(inputFileName, dataStart, plan, spotLookup, freq);
+                if(follow)
+                {
+                    LogFollower follower(logFile, plan, spotLookup, freq, dataStart);
+                    foreach(FrameSink *sink, sinks)
+                        follower.addSink(sink);
+                    if(outFileBin.isOpen())
+                        follower.addFile(&outFileBin);
+                    if(outFileSpot.isOpen())
+                        follower.addFile(&outFileSpot);
+                    if(motorCompressed.isOpen())
+                        follower.addCompressedFile(&motorCompressed);
+                    if(spotCompressed.isOpen())
+                        follower.addCompressedFile(&spotCompressed);
+                    follower.setIdleTimeout(options.idleSeconds);
+                    follower.setProgressInterval(options.progressSeconds);
+                    written = follower.run();
+                    messages = follower.messages();
+                    lostBytes = follower.lostBytes();
+                    gaps = follower.gapCount();
+                    follower.addStats(*stats);
+                }
+                else if(!window && chunked.split(threads))
+                {
+                    foreach(FrameSink *sink, sinks)
+                        chunked.addSink(sink);
+                    chunked.setProgressInterval(options.progressSeconds);
+                    written = chunked.run(threads);
+                    entries = chunked.indexEntries();
+                    messages = chunked.messages();
+                    lostBytes = chunked.lostBytes();
+                    gaps = chunked.gapCount();
+                    chunked.addStats(*stats);
+                }
+                else
+                {
+                    FrameReader reader(logFile, plan);
+                    SpotAssembler spots(spotLookup, plan.counterMask());
+                    DecodePipeline pipeline(reader, plan, spots, freq, spotLookup.size());
+                    if(window)
+                    { //start from the last index entry before the window, the messages up to it only rebuild the spot values
+                        const FrameIndexEntry *entry = index.before(startMessage);
+                        if(entry != nullptr)
+                            reader.start(entry->offset, true, entry->message);
+                        reader.setLastMessage(endMessage);
+                        pipeline.setFirstOutput(startMessage);
+                    }
+                    else
+                        reader.setIndex(&entries);
+                    foreach(FrameSink *sink, sinks)
+                        pipeline.addSink(sink);
+                    pipeline.setProgressInterval(options.progressSeconds);
+                    written = pipeline.run(threads);
+                    messages = pipeline.messages();
+                    lostBytes = reader.lostBytes();
+                    gaps = reader.gapCount();
+                    pipeline.addStats(*stats);
+                }
+                if(!window && !indexed)
+                {
+                    index.set(entries, messages);
+                    if(!index.save(inputFileName, dataStart, plan.messageBytes(), indexFileName))
+                        qDebug("Could not write index file");
+                }
+                stats->messages = (messages > startMessage) ? messages - startMessage : 0;
+                stats->lostBytes = lostBytes;
+                stats->gaps = gaps;
+                for(int i=0;i<sinks.size();i++)
+                    stats->addOutput(sinkNames[i], sinks[i]->time());
+                if(!written)
+                    qDebug("Error writing output files");
+                qDebug("Processing Complete");
+            }
+            else
+            {
+                qDebug("Json header message length invalid");
+                decoded = false;
+            }
+        }
+//        else
+//            qDebug("Could not open output file"); //removed - valid case if just generating json
+
+        QElapsedTimer closing;
+        if(motorCompressed.isOpen())
+        {
+            closing.start();
+            if(!motorCompressed.finish())
+                qDebug("Could not write motor data file");
+            motorCompressed.close();
+            stats->addOutput("motor csv", closing.nsecsElapsed());
+        }
+        if(spotCompressed.isOpen())
+        {
+            closing.start();
+            if(!spotCompressed.finish())
+                qDebug("Could not write spot value file");
+            spotCompressed.close();
+            stats->addOutput("spot csv", closing.nsecsElapsed());
+        }
+
+        if(genColumnFile)
+        {
+            closing.start();
+            if(columnFile.close())
+                qDebug("Columnar file created");
+            else
+                qDebug("Could not write columnar file");
+            stats->addOutput("columns", closing.nsecsElapsed());
+        }
+
+        if(genMotPVFile)
+        {
+            closing.start();
+            if(pvFile.close())
+                qDebug("PulseViewFile created");
+            else
+                qDebug("Could not write PulseView file");
+            stats->addOutput("pulseview", closing.nsecsElapsed());
+        }
+    }
+    else
+        qDebug("%s", qPrintable(headerError));
+
+    logFile.close();
+    outFileBin.close();
+    outFileSpot.close();
+
+    stats->wallNanos = timer.nsecsElapsed();
+    stats->peakMemory = peakMemoryBytes();
+    if(decoded && options.printStats)
+        stats->print();
+    if(decoded && !options.statsFile.isEmpty() && !saveStatsReport(options.statsFile, stats->toJson()))
+        qDebug("Could not write %s", qPrintable(options.statsFile));
+    return decoded;
+}
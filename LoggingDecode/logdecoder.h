@@ -0,0 +1,74 @@
+#ifndef LOGDECODER_H
+#define LOGDECODER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "compressedfile.h"
+#include "csvwriter.h"
+#include "decodeplan.h"
+#include "decodestats.h"
+
+//what to make from a log, as given on the command line
+struct DecodeOptions
+{
+    DecodeOptions();
+
+    bool motorPV;
+    bool motorCsv;
+    bool spotCsv;
+    bool json;
+    bool columns;
+    bool srStore;
+    CsvPrecision precision;
+    int threads;
+    bool buildIndex;
+    QString start; //--start/--end as given, empty if not set
+    QString end;
+    bool follow;
+    int idleSeconds;
+    QStringList derived; //extra derived channels asked for with --derive
+    QStringList fields;     //motor channels to output, empty for all
+    QStringList spotFields; //spot values to output, empty for all
+    CompressionFormat compression; //for the CSV files
+    int compressionLevel;
+    QString trigger;     //--trigger expression, empty for the whole log
+    double triggerPre;   //seconds kept before and after each hit
+    double triggerPost;
+    int triggerSegments;
+    QVector<int> envelope; //--envelope decimation factors, empty for none
+    bool envelopeSr;
+    bool summary;        //channel statistics instead of (or as well as) the sample outputs
+    int progressSeconds; //log time between progress lines, 0 for none
+    bool printStats;
+    QString statsFile;   //--stats-json, empty if not set
+};
+
+//A decode plan for each log format (the second JSON header) and set of parameters it depends
+//on, so a batch of logs from the same firmware parses the format and builds the plan once.
+class DecodePlanCache
+{
+public:
+    struct Entry
+    {
+        QVector<varDefinitions> varDefs;
+        DecodePlan plan;
+        bool valid;
+    };
+
+    QSharedPointer<const Entry> find(const QByteArray &format, double modmax, uint32_t maxpwm, const QStringList &derived, const QStringList &fields, const QStringList &decoded = QStringList());
+
+private:
+    QMutex lock;
+    QMap<QByteArray, QSharedPointer<const Entry> > entries;
+};
+
+//indexFileName is where the frame index is kept, empty for next to the log
+bool decodeLog(const QString &inputFileName, const QString &baseOpFileName, const DecodeOptions &options, DecodePlanCache &plans, DecodeStats *stats = nullptr, const QString &indexFileName = QString());
+
+#endif // LOGDECODER_H
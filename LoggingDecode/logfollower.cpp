@@ -0,0 +1,161 @@
+#include "logfollower.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <csignal>
+
+#include "pipeline.h"
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void requestStop(int)
+{
+    stopRequested = 1;
+}
+
+//the first bytes of a log, short if it doesn't have that many yet
+static QByteArray readHeader(const QString &fileName, qint64 bytes)
+{
+    QFile file(fileName);
+    if(!file.open(QFile::ReadOnly))
+        return QByteArray();
+    return file.read(bytes);
+}
+
+LogFollower::LogFollower(LogSource &source, const DecodePlan &plan, const QMap<uint32_t, QString> &spotLookup, uint32_t freq, qint64 dataStart) :
+    source(source),
+    plan(plan),
+    spotLookup(spotLookup),
+    freq(freq),
+    dataStart(dataStart),
+    header(readHeader(source.fileName(), dataStart)),
+    reader(source, plan),
+    spots(spotLookup, plan.counterMask()),
+    idleMs(0),
+    progressSeconds(PROGRESS_SECONDS)
+{
+}
+
+//the open log has been truncated, deleted or replaced by a new file.  A replacement that is
+//already bigger than the old log with an identical header can't be told apart from it growing.
+bool LogFollower::replaced()
+{
+    qint64 handleSize = source.size(); //before the path, so a log that is only growing can't look smaller
+    QFileInfo info(source.fileName());
+    if(!info.exists() || (info.size() < handleSize) || (handleSize < reader.position()))
+        return true;
+    return readHeader(source.fileName(), dataStart) != header;
+}
+
+//open the log again once the new one has its headers, false if it isn't ready yet
+bool LogFollower::reopen()
+{
+    if((readHeader(source.fileName(), dataStart) != header) || !source.open())
+        return false;
+    if(!reader.start(dataStart, false, reader.messageNumber()))
+    {
+        source.close();
+        return false;
+    }
+    earlier.spotSets += spots.completeSets();
+    earlier.incompleteSpotSets += spots.incompleteSets();
+    earlier.countGaps += spots.countGaps();
+    spots = SpotAssembler(spotLookup, plan.counterMask());
+    qDebug("Log restarted, continuing at %.6f s", (double)reader.messageNumber()/freq);
+    return true;
+}
+
+bool LogFollower::flush()
+{
+    bool ok = true;
+    foreach(CompressedFile *file, compressed)
+        ok &= file->flush();
+    foreach(QFileDevice *file, files)
+        ok &= file->flush();
+    return ok;
+}
+
+bool LogFollower::run()
+{
+    stopRequested = 0;
+    void (*previousInt)(int) = std::signal(SIGINT, requestStop);
+    void (*previousTerm)(int) = std::signal(SIGTERM, requestStop);
+    qDebug("Following log, Ctrl+C to stop");
+
+    bool ok = true;
+    bool unflushed = false;
+    MessageBlock block;
+    FrameBatch batch;
+    QElapsedTimer sinceData, sinceFlush, timer;
+    sinceData.start();
+    sinceFlush.start();
+    while(!stopRequested)
+    {
+        int count = source.isOpen() ? reader.read(block) : 0;
+        if(count > 0)
+        {
+            quint64 first = reader.messageNumber() - count;
+            batch.reset(plan.valueCount(), spotLookup.size(), count);
+            batch.firstMessage = first;
+            plan.decode((const uchar *)block.data.constData(), count, batch, spots, &times);
+            foreach(const QString &message, progressMessages(first, first + batch.rows, freq, progressSeconds))
+                qDebug("%s", qPrintable(message));
+            foreach(FrameSink *sink, sinks)
+            {
+                timer.start();
+                ok &= sink->write(batch);
+                sink->addTime(timer.nsecsElapsed());
+            }
+            unflushed = true;
+            sinceData.restart();
+            if(sinceFlush.elapsed() < FOLLOW_FLUSH_MS)
+                continue;
+        }
+
+        //caught up (or been busy for a while), let the outputs be seen
+        if(unflushed)
+        {
+            ok &= flush();
+            unflushed = false;
+            sinceFlush.restart();
+        }
+        if(count > 0)
+            continue;
+        if((idleMs > 0) && (sinceData.elapsed() >= idleMs))
+            break;
+
+        if(source.isOpen() && replaced())
+        {
+            qDebug("Log truncated or replaced, waiting for the new one");
+            source.close();
+        }
+        if(!source.isOpen() && reopen())
+            continue;
+        QThread::msleep(FOLLOW_POLL_MS);
+    }
+
+    std::signal(SIGINT, previousInt);
+    std::signal(SIGTERM, previousTerm);
+    if(reader.gapCount() > 0)
+        qDebug("Lost %lld bytes in %d gaps", (long long)reader.lostBytes(), reader.gapCount());
+    foreach(FrameSink *sink, sinks)
+    {
+        timer.start();
+        ok &= sink->finish();
+        sink->addTime(timer.nsecsElapsed());
+    }
+    return ok & flush();
+}
+
+void LogFollower::addStats(DecodeStats &stats) const
+{
+    stats.resyncs += reader.resyncCount();
+    stats.spotSets += earlier.spotSets + spots.completeSets();
+    stats.incompleteSpotSets += earlier.incompleteSpotSets + spots.incompleteSets();
+    stats.countGaps += earlier.countGaps + spots.countGaps();
+    stats.stages.add(reader.stageTimes());
+    stats.stages.add(times);
+}
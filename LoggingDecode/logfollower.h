@@ -0,0 +1,63 @@
+#ifndef LOGFOLLOWER_H
+#define LOGFOLLOWER_H
+
+#include <QFileDevice>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+#include "compressedfile.h"
+#include "framereader.h"
+#include "framesinks.h"
+#include "spotassembler.h"
+
+#define FOLLOW_POLL_MS 100   //wait between looks for more data once caught up
+#define FOLLOW_FLUSH_MS 500  //longest outputs are left unflushed while there is data to decode
+
+//Decodes a log that is still being written, for --follow.  Everything already in the file is
+//decoded, then the file is polled for more and each new run of complete messages is decoded
+//and written as it arrives, with the output files flushed whenever it catches up (and at least
+//every FOLLOW_FLUSH_MS while it doesn't) so they can be watched live.  If the log is truncated
+//or replaced, the new one is followed from the start of its data as long as it has the same
+//headers; its times carry on from the old one so the outputs stay in order.  Runs until
+//interrupted (Ctrl+C) or, if set, the log hasn't grown for the idle time.
+class LogFollower
+{
+public:
+    LogFollower(LogSource &source, const DecodePlan &plan, const QMap<uint32_t, QString> &spotLookup, uint32_t freq, qint64 dataStart);
+
+    void addSink(FrameSink *sink) { sinks.append(sink); }
+    void addFile(QFileDevice *file) { files.append(file); }
+    void addCompressedFile(CompressedFile *file) { compressed.append(file); } //flushed before the files
+    void setIdleTimeout(int seconds) { idleMs = (qint64)seconds*1000; }
+    void setProgressInterval(int seconds) { progressSeconds = seconds; }
+    bool run();
+
+    quint64 messages() const { return reader.messageNumber(); }
+    qint64 lostBytes() const { return reader.lostBytes(); }
+    int gapCount() const { return reader.gapCount(); }
+    void addStats(DecodeStats &stats) const;
+
+private:
+    bool replaced();
+    bool reopen();
+    bool flush();
+
+    LogSource &source;
+    const DecodePlan &plan;
+    QMap<uint32_t, QString> spotLookup;
+    uint32_t freq;
+    qint64 dataStart;
+    QByteArray header; //the log up to dataStart, to recognise a replacement with the same format
+    FrameReader reader;
+    SpotAssembler spots;
+    QList<FrameSink *> sinks;
+    QList<QFileDevice *> files;
+    QList<CompressedFile *> compressed;
+    qint64 idleMs;
+    int progressSeconds;
+    StageTimes times;
+    DecodeStats earlier; //spot counters of the logs before a restart
+};
+
+#endif // LOGFOLLOWER_H
@@ -0,0 +1,210 @@
+#include "pipeline.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+WriterStage::WriterStage(const QList<FrameSink *> &sinks, const QList<int> &sinkIndexes, bool threaded, int depth) :
+    sinks(sinks),
+    sinkIndexes(sinkIndexes),
+    queue(depth),
+    threaded(threaded),
+    ok(true)
+{
+    if(threaded)
+    {
+        thread = std::thread([this]()
+        {
+            WriterJob job;
+            while(queue.pop(job))
+                write(job);
+        });
+    }
+}
+
+WriterStage::~WriterStage()
+{
+    if(thread.joinable())
+    {
+        queue.close();
+        thread.join();
+    }
+}
+
+void WriterStage::write(const WriterJob &job)
+{
+    QElapsedTimer timer;
+    for(int i=0;i<sinks.size();i++)
+    {
+        timer.start();
+        if(!job.batch.isNull())
+            ok &= sinks[i]->write(*job.batch);
+        if(!job.encoded.isNull())
+            foreach(const QByteArray &block, job.encoded->blocks[sinkIndexes[i]])
+                ok &= sinks[i]->append(block);
+        sinks[i]->addTime(timer.nsecsElapsed());
+    }
+}
+
+void WriterStage::post(const WriterJob &job)
+{
+    if(threaded)
+        queue.push(job);
+    else
+        write(job);
+}
+
+//wait for everything queued to be written then flush the sinks, returns false if any write failed
+bool WriterStage::finish()
+{
+    if(thread.joinable())
+    {
+        queue.close();
+        thread.join();
+    }
+    QElapsedTimer timer;
+    foreach(FrameSink *sink, sinks)
+    {
+        timer.start();
+        ok &= sink->finish();
+        sink->addTime(timer.nsecsElapsed());
+    }
+    return ok;
+}
+
+//Progress lines for each interval of log time passed going from one message count to another,
+//in minutes when the interval is whole minutes.  An interval of 0 turns them off.
+QStringList progressMessages(quint64 from, quint64 to, uint32_t freq, int seconds)
+{
+    QStringList messages;
+    if((seconds <= 0) || (freq == 0))
+        return messages;
+    quint64 interval = (quint64)freq*seconds;
+    for(quint64 done=(from/interval + 1)*interval;done<=to;done+=interval)
+    {
+        if(seconds%60 == 0)
+            messages << QString::asprintf("Processed %i minutes of data",(int)(done/((quint64)freq*60)));
+        else
+            messages << QString::asprintf("Processed %i seconds of data",(int)(done/freq));
+    }
+    return messages;
+}
+
+DecodePipeline::DecodePipeline(FrameReader &reader, const DecodePlan &plan, SpotAssembler &spots, uint32_t freq, int spotColumns) :
+    reader(reader),
+    plan(plan),
+    spots(spots),
+    freq(freq),
+    spotColumns(spotColumns),
+    messageCount(0),
+    firstOutput(0),
+    progressSeconds(PROGRESS_SECONDS),
+    outputStart(spots)
+{
+}
+
+//run messages before the first output through the spot assembler only, returns how many of the block that was
+int DecodePipeline::prime(const MessageBlock &block)
+{
+    if(messageCount >= firstOutput)
+        return 0;
+    int count = qMin<quint64>(block.count, firstOutput - messageCount);
+    primeValues.resize(plan.valueCount());
+    const uchar *message = (const uchar *)block.data.constData();
+    for(int i=0;i<count;i++,message+=plan.messageBytes())
+        plan.decode(message, primeValues.data(), spots);
+    messageCount += count;
+    return count;
+}
+
+void DecodePipeline::decode(const MessageBlock &block, const QList<WriterStage *> &stages)
+{
+    bool priming = messageCount < firstOutput;
+    int first = prime(block);
+    if(first == block.count)
+        return;
+    if(priming)
+        outputStart = spots;
+
+    QSharedPointer<FrameBatch> batch = QSharedPointer<FrameBatch>::create();
+    batch->reset(plan.valueCount(), spotColumns, block.count - first);
+    batch->firstMessage = messageCount;
+    plan.decode((const uchar *)block.data.constData() + first*plan.messageBytes(), block.count - first, *batch, spots, &times);
+
+    foreach(const QString &message, progressMessages(messageCount, messageCount + batch->rows, freq, progressSeconds))
+        qDebug("%s", qPrintable(message));
+    messageCount += batch->rows;
+
+    WriterJob job;
+    job.batch = batch;
+    foreach(WriterStage *stage, stages)
+        stage->post(job);
+}
+
+//Threads are handed out to the writers first (they do the most work), one each while they
+//last, then one more goes to the decoder.  With fewer threads than writers the writers share,
+//and with a single thread everything runs inline here.
+bool DecodePipeline::run(int threads)
+{
+    messageCount = reader.messageNumber();
+    int extra = qMax(threads, 1) - 1;
+    int writerThreads = qMin(sinks.size(), extra);
+    bool decodeThread = extra > writerThreads;
+
+    QList<WriterStage *> stages;
+    if(writerThreads == 0)
+        stages.append(new WriterStage(sinks, QList<int>(), false));
+    else
+    {
+        QVector<QList<FrameSink *> > groups(writerThreads);
+        for(int i=0;i<sinks.size();i++)
+            groups[i%writerThreads].append(sinks[i]);
+        for(int i=0;i<writerThreads;i++)
+            stages.append(new WriterStage(groups[i], QList<int>(), true));
+    }
+
+    if(decodeThread)
+    {
+        SpscQueue<QSharedPointer<MessageBlock> > blocks;
+        std::thread decoder([&]()
+        {
+            QSharedPointer<MessageBlock> block;
+            while(blocks.pop(block))
+                decode(*block, stages);
+        });
+        while(true)
+        {
+            QSharedPointer<MessageBlock> block = QSharedPointer<MessageBlock>::create();
+            if(reader.read(*block) == 0)
+                break;
+            blocks.push(block);
+        }
+        blocks.close();
+        decoder.join();
+    }
+    else
+    {
+        MessageBlock block;
+        while(reader.read(block) > 0)
+            decode(block, stages);
+    }
+    if(reader.gapCount() > 0)
+        qDebug("Lost %lld bytes in %d gaps", (long long)reader.lostBytes(), reader.gapCount());
+
+    bool ok = true;
+    foreach(WriterStage *stage, stages)
+    {
+        ok &= stage->finish();
+        delete stage;
+    }
+    return ok;
+}
+
+void DecodePipeline::addStats(DecodeStats &stats) const
+{
+    stats.resyncs += reader.resyncCount();
+    stats.spotSets += spots.completeSets() - outputStart.completeSets();
+    stats.incompleteSpotSets += spots.incompleteSets() - outputStart.incompleteSets();
+    stats.countGaps += spots.countGaps() - outputStart.countGaps();
+    stats.stages.add(reader.stageTimes());
+    stats.stages.add(times);
+}
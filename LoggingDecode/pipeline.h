@@ -0,0 +1,88 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <QList>
+#include <QSharedPointer>
+#include <QStringList>
+#include <thread>
+
+#include "framereader.h"
+#include "framesinks.h"
+#include "spscqueue.h"
+
+//output already encoded elsewhere, a list of blocks for each sink (in sink order)
+struct EncodedChunk
+{
+    QVector<QList<QByteArray> > blocks;
+};
+
+//a batch to encode and write, or an encoded chunk to append
+struct WriterJob
+{
+    QSharedPointer<const FrameBatch> batch;
+    QSharedPointer<const EncodedChunk> encoded;
+};
+
+//One or more sinks that are written together, either inline on the calling thread or on a
+//thread of their own fed through a queue.
+class WriterStage
+{
+public:
+    WriterStage(const QList<FrameSink *> &sinks, const QList<int> &sinkIndexes, bool threaded, int depth = SPSC_QUEUE_DEPTH);
+    ~WriterStage();
+
+    void post(const WriterJob &job);
+    bool finish();
+
+private:
+    void write(const WriterJob &job);
+
+    QList<FrameSink *> sinks;
+    QList<int> sinkIndexes; //where each sink's blocks are in an EncodedChunk
+    SpscQueue<WriterJob> queue;
+    std::thread thread;
+    bool threaded;
+    bool ok;
+};
+
+//Reader -> decoder -> writers.  The reader validates messages, the decoder unpacks them into
+//columnar batches (keeping the spot value assembly in order) and every batch is handed to each
+//writer stage in turn, so the outputs are the same whatever the thread count.  When the reader
+//starts part way into the log, messages before the first one to output only go through the
+//spot assembler so its state is right once output starts.
+class DecodePipeline
+{
+public:
+    DecodePipeline(FrameReader &reader, const DecodePlan &plan, SpotAssembler &spots, uint32_t freq, int spotColumns);
+
+    void addSink(FrameSink *sink) { sinks.append(sink); }
+    void setFirstOutput(quint64 message) { firstOutput = message; }
+    void setProgressInterval(int seconds) { progressSeconds = seconds; }
+    bool run(int threads);
+
+    quint64 messages() const { return messageCount; }
+    void addStats(DecodeStats &stats) const;
+
+private:
+    void decode(const MessageBlock &block, const QList<WriterStage *> &stages);
+    int prime(const MessageBlock &block);
+
+    FrameReader &reader;
+    const DecodePlan &plan;
+    SpotAssembler &spots;
+    uint32_t freq;
+    int spotColumns;
+    QList<FrameSink *> sinks;
+    quint64 messageCount;
+    quint64 firstOutput;
+    int progressSeconds;
+    QVector<double> primeValues;
+    SpotAssembler outputStart; //spot state once priming is done, the counters are taken from here
+    StageTimes times;
+};
+
+#define PROGRESS_SECONDS 60 //default time between progress lines
+
+QStringList progressMessages(quint64 from, quint64 to, uint32_t freq, int seconds = PROGRESS_SECONDS);
+
+#endif // PIPELINE_H
@@ -0,0 +1,391 @@
+#include "signalsummary.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <cmath>
+#include <cstring>
+
+#include "csvwriter.h"
+
+#define SUMMARY_MAX_INDEX 4611686018427387904.0 //2^62, bin numbers are kept well inside a qint64
+
+//value/2^shift rounded down, for bin numbers
+static qint64 floorShift(qint64 value, int shift)
+{
+    if(shift <= 0)
+        return value;
+    if(shift > 62)
+        return (value < 0) ? -1 : 0;
+    return (value >= 0) ? (value >> shift) : -((-value - 1) >> shift) - 1;
+}
+
+void ChannelSummary::clear()
+{
+    count = 0;
+    mean = 0;
+    m2 = 0;
+    sumSquares = 0;
+    min = 0;
+    max = 0;
+    minMessage = 0;
+    maxMessage = 0;
+    exponent = SUMMARY_MIN_EXPONENT;
+    firstBin = 0;
+    lastBin = -1; //no bins used
+    memset(bins, 0, sizeof(bins));
+}
+
+//Add count values to bin index of a histogram with bins 2^indexExponent wide, widening the
+//bins (ours or the index) to the wider of the two and then on until everything fits.
+void ChannelSummary::addToBin(qint64 index, int indexExponent, quint64 count)
+{
+    bool empty = lastBin < firstBin;
+    int shift = qMax(indexExponent - exponent, 0);
+    index = floorShift(index, exponent - indexExponent);
+    qint64 low = empty ? index : qMin(floorShift(firstBin, shift), index);
+    qint64 high = empty ? index : qMax(floorShift(lastBin, shift), index);
+    int more = 0;
+    while(floorShift(high, more) - floorShift(low, more) >= SUMMARY_BINS)
+        more++;
+    shift += more;
+    low = floorShift(low, more);
+    high = floorShift(high, more);
+    index = floorShift(index, more);
+
+    if(!empty && ((shift > 0) || (low != firstBin)))
+    {
+        quint64 old[SUMMARY_BINS];
+        memcpy(old, bins, sizeof(bins));
+        memset(bins, 0, sizeof(bins));
+        for(qint64 bin=firstBin;bin<=lastBin;bin++)
+            bins[floorShift(bin, shift) - low] += old[bin - firstBin];
+    }
+    exponent += shift;
+    firstBin = low;
+    lastBin = high;
+    bins[index - low] += count;
+}
+
+//one value at a time (Welford), for the spot values
+void ChannelSummary::add(double value, quint64 message)
+{
+    if(std::isnan(value))
+        return;
+    count++;
+    double delta = value - mean;
+    mean += delta/count;
+    m2 += delta*(value - mean);
+    sumSquares += value*value;
+    if((count == 1) || (value < min))
+    {
+        min = value;
+        minMessage = message;
+    }
+    if((count == 1) || (value > max))
+    {
+        max = value;
+        maxMessage = message;
+    }
+
+    int binExponent = exponent;
+    while(std::fabs(std::ldexp(value, -binExponent)) >= SUMMARY_MAX_INDEX)
+        binExponent++;
+    addToBin((qint64)std::floor(std::ldexp(value, -binExponent)), binExponent, 1);
+}
+
+//a run of messages' values, summarised on their own (two passes, the rows being in cache) and then merged in
+void ChannelSummary::addRows(const double *values, int rows, quint64 firstMessage)
+{
+    ChannelSummary group;
+    group.clear();
+    double sum = 0;
+    for(int i=0;i<rows;i++)
+    {
+        double value = values[i];
+        if(std::isnan(value))
+            continue;
+        if((group.count == 0) || (value < group.min))
+        {
+            group.min = value;
+            group.minMessage = firstMessage + i;
+        }
+        if((group.count == 0) || (value > group.max))
+        {
+            group.max = value;
+            group.maxMessage = firstMessage + i;
+        }
+        group.count++;
+        sum += value;
+        group.sumSquares += value*value;
+    }
+    if(group.count == 0)
+        return;
+    group.mean = sum/group.count;
+
+    double scale = std::ldexp(1.0, -group.exponent);
+    for(int i=0;i<rows;i++)
+    {
+        double value = values[i];
+        if(std::isnan(value))
+            continue;
+        double difference = value - group.mean;
+        group.m2 += difference*difference;
+
+        double scaled = value*scale;
+        qint64 index = (std::fabs(scaled) < SUMMARY_MAX_INDEX) ? (qint64)std::floor(scaled) : 0;
+        if((group.lastBin >= group.firstBin) && (std::fabs(scaled) < SUMMARY_MAX_INDEX)
+                && (index >= group.firstBin) && (index < group.firstBin + SUMMARY_BINS))
+        {
+            group.bins[index - group.firstBin]++;
+            group.lastBin = qMax(group.lastBin, index);
+        }
+        else
+        {
+            int binExponent = group.exponent;
+            while(std::fabs(std::ldexp(value, -binExponent)) >= SUMMARY_MAX_INDEX)
+                binExponent++;
+            group.addToBin((qint64)std::floor(std::ldexp(value, -binExponent)), binExponent, 1);
+            scale = std::ldexp(1.0, -group.exponent);
+        }
+    }
+    merge(group);
+}
+
+void ChannelSummary::merge(const ChannelSummary &other)
+{
+    if(other.count == 0)
+        return;
+    if(count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    quint64 total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta*other.count/total;
+    m2 += other.m2 + delta*delta*((double)count*other.count/total);
+    sumSquares += other.sumSquares;
+    if(other.min < min)
+    {
+        min = other.min;
+        minMessage = other.minMessage;
+    }
+    if(other.max > max)
+    {
+        max = other.max;
+        maxMessage = other.maxMessage;
+    }
+    count = total;
+    for(qint64 bin=other.firstBin;bin<=other.lastBin;bin++)
+        if(other.bins[bin - other.firstBin] != 0)
+            addToBin(bin, other.exponent, other.bins[bin - other.firstBin]);
+}
+
+QJsonObject ChannelSummary::toJson(uint32_t freq) const
+{
+    QJsonObject summary;
+    summary.insert("count", (qint64)count);
+    if(count == 0)
+        return summary;
+
+    MessageClock clock(freq);
+    clock.seek(minMessage);
+    summary.insert("min", min);
+    summary.insert("minTime", clock.micros()/1e6);
+    clock.seek(maxMessage);
+    summary.insert("max", max);
+    summary.insert("maxTime", clock.micros()/1e6);
+    summary.insert("mean", mean);
+    summary.insert("rms", std::sqrt(sumSquares/count));
+    summary.insert("stddev", std::sqrt(m2/count));
+
+    double width = std::ldexp(1.0, exponent);
+    QJsonArray counts;
+    for(qint64 bin=firstBin;bin<=lastBin;bin++)
+        counts.append((qint64)bins[bin - firstBin]);
+    QJsonObject histogram;
+    histogram.insert("start", firstBin*width);
+    histogram.insert("binWidth", width);
+    histogram.insert("counts", counts);
+    summary.insert("histogram", histogram);
+    return summary;
+}
+
+//each batch is its first message and how many of each part there are, then the rows before
+//the first whole group a column at a time, the group summaries, the rows after the last whole
+//group and the spot sets (message number then values)
+struct SummaryBlockHeader
+{
+    quint64 firstMessage;
+    qint32 leadRows;
+    qint32 groups;
+    qint32 tailRows;
+    qint32 spotSets;
+};
+
+SummarySink::SummarySink(QIODevice *json, QIODevice *csv, uint32_t freq, const QStringList &names, const QVector<int> &columns, const QStringList &spotNames) :
+    json(json),
+    csv(csv),
+    freq(freq),
+    names(names),
+    columns(columns),
+    spotNames(spotNames),
+    motor(columns.size()),
+    spots(spotNames.size()),
+    pending(columns.size()*SUMMARY_GROUP_ROWS),
+    pendingRows(0),
+    pendingFirst(0)
+{
+    for(int i=0;i<motor.size();i++)
+        motor[i].clear();
+    for(int i=0;i<spots.size();i++)
+        spots[i].clear();
+}
+
+void SummarySink::encode(const FrameBatch &batch, QByteArray &block) const
+{
+    int lead = qMin<quint64>(batch.rows, (SUMMARY_GROUP_ROWS - batch.firstMessage%SUMMARY_GROUP_ROWS)%SUMMARY_GROUP_ROWS);
+    int groups = (batch.rows - lead)/SUMMARY_GROUP_ROWS;
+    int tail = batch.rows - lead - groups*SUMMARY_GROUP_ROWS;
+    int sets = batch.spotSets();
+    int start = block.size();
+    block.resize(start + sizeof(SummaryBlockHeader) + groups*columns.size()*sizeof(ChannelSummary)
+                 + ((lead + tail)*columns.size() + sets*(batch.spotColumns + 1))*sizeof(double));
+    SummaryBlockHeader *header = (SummaryBlockHeader *)(block.data() + start);
+    header->firstMessage = batch.firstMessage;
+    header->leadRows = lead;
+    header->groups = groups;
+    header->tailRows = tail;
+    header->spotSets = sets;
+
+    double *out = (double *)(header + 1);
+    for(int i=0;i<columns.size();i++,out+=lead)
+        memcpy(out, batch.column(columns[i]), lead*sizeof(double));
+    ChannelSummary *summary = (ChannelSummary *)out;
+    for(int group=0;group<groups;group++)
+    {
+        int row = lead + group*SUMMARY_GROUP_ROWS;
+        for(int i=0;i<columns.size();i++,summary++)
+        {
+            summary->clear();
+            summary->addRows(batch.column(columns[i]) + row, SUMMARY_GROUP_ROWS, batch.firstMessage + row);
+        }
+    }
+    out = (double *)summary;
+    for(int i=0;i<columns.size();i++,out+=tail)
+        memcpy(out, batch.column(columns[i]) + batch.rows - tail, tail*sizeof(double));
+    for(int set=0;set<sets;set++)
+    {
+        *out++ = (double)(batch.firstMessage + batch.spotRows[set]);
+        memcpy(out, batch.spotSet(set), batch.spotColumns*sizeof(double));
+        out += batch.spotColumns;
+    }
+}
+
+//rows of the group being filled, summarised once it is full
+void SummarySink::addPending(const double *values, int rows, int stride, quint64 firstMessage)
+{
+    if(rows == 0)
+        return;
+    if(pendingRows == 0)
+        pendingFirst = firstMessage;
+    for(int i=0;i<columns.size();i++)
+        memcpy(pending.data() + i*SUMMARY_GROUP_ROWS + pendingRows, values + i*stride, rows*sizeof(double));
+    pendingRows += rows;
+    if((pendingFirst + pendingRows)%SUMMARY_GROUP_ROWS == 0)
+    {
+        for(int i=0;i<columns.size();i++)
+            motor[i].addRows(pending.constData() + i*SUMMARY_GROUP_ROWS, pendingRows, pendingFirst);
+        pendingRows = 0;
+    }
+}
+
+bool SummarySink::append(const QByteArray &block)
+{
+    const char *in = block.constData();
+    const char *end = in + block.size();
+    while(in + sizeof(SummaryBlockHeader) <= end)
+    {
+        const SummaryBlockHeader *header = (const SummaryBlockHeader *)in;
+        const double *values = (const double *)(header + 1);
+        addPending(values, header->leadRows, header->leadRows, header->firstMessage);
+        values += header->leadRows*columns.size();
+
+        const ChannelSummary *summary = (const ChannelSummary *)values;
+        for(int group=0;group<header->groups;group++)
+            for(int i=0;i<columns.size();i++)
+                motor[i].merge(*summary++);
+        values = (const double *)summary;
+
+        quint64 tailFirst = header->firstMessage + header->leadRows + header->groups*SUMMARY_GROUP_ROWS;
+        addPending(values, header->tailRows, header->tailRows, tailFirst);
+        values += header->tailRows*columns.size();
+
+        for(int set=0;set<header->spotSets;set++)
+        {
+            quint64 message = (quint64)*values++;
+            for(int i=0;i<spots.size();i++)
+                spots[i].add(*values++, message);
+        }
+        in = (const char *)values;
+    }
+    return true;
+}
+
+bool SummarySink::finish()
+{
+    if(pendingRows > 0)
+    { //the last part group
+        for(int i=0;i<columns.size();i++)
+            motor[i].addRows(pending.constData() + i*SUMMARY_GROUP_ROWS, pendingRows, pendingFirst);
+        pendingRows = 0;
+    }
+
+    QJsonArray motorList, spotList;
+    for(int i=0;i<motor.size();i++)
+    {
+        QJsonObject entry = motor[i].toJson(freq);
+        entry.insert("name", names[i]);
+        motorList.append(entry);
+    }
+    for(int i=0;i<spots.size();i++)
+    {
+        QJsonObject entry = spots[i].toJson(freq);
+        entry.insert("name", spotNames[i]);
+        spotList.append(entry);
+    }
+    QJsonObject report;
+    report.insert("frequency", (qint64)freq);
+    report.insert("motor", motorList);
+    report.insert("spots", spotList);
+    QByteArray text = QJsonDocument(report).toJson();
+    bool ok = json->write(text) == text.size();
+
+    CsvWriter table(csv);
+    const char *const headings[] = {"Channel", "Count", "Min", "Min Time(s)", "Max", "Max Time(s)", "Mean", "RMS", "Std Dev"};
+    for(const char *heading : headings)
+        table.addText(heading);
+    table.endRow();
+    MessageClock clock(freq);
+    for(int i=0;i<motor.size() + spots.size();i++)
+    {
+        const ChannelSummary &summary = (i < motor.size()) ? motor[i] : spots[i - motor.size()];
+        table.addText((i < motor.size()) ? names[i] : spotNames[i - motor.size()]);
+        table.addValue(summary.count, 0);
+        if(summary.count > 0)
+        {
+            table.addValue(summary.min);
+            clock.seek(summary.minMessage);
+            table.addTime(clock.micros());
+            table.addValue(summary.max);
+            clock.seek(summary.maxMessage);
+            table.addTime(clock.micros());
+            table.addValue(summary.mean);
+            table.addValue(std::sqrt(summary.sumSquares/summary.count));
+            table.addValue(std::sqrt(summary.m2/summary.count));
+        }
+        table.endRow();
+    }
+    return table.flush() && ok;
+}
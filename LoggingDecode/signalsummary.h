@@ -0,0 +1,80 @@
+#ifndef SIGNALSUMMARY_H
+#define SIGNALSUMMARY_H
+
+#include <QIODevice>
+#include <QJsonObject>
+#include <QStringList>
+#include <QVector>
+
+#include "framesinks.h"
+
+#define SUMMARY_BINS 64
+#define SUMMARY_MIN_EXPONENT -16  //narrowest histogram bin is 2^-16
+#define SUMMARY_GROUP_ROWS 4096   //motor messages summarised together before being merged
+
+//Running statistics for one channel: count, min/max and the message they were first seen at,
+//mean and sum of squared differences from it (merged Welford/Chan style), sum of squares for
+//the RMS, and a histogram of SUMMARY_BINS bins.  The bins are a power of two wide, starting at
+//the narrowest and doubling whenever the values seen don't fit in SUMMARY_BINS of them, with
+//bin k holding [k*width, (k+1)*width).  So however the values are split up and merged the
+//histogram comes out the same, the narrowest one that covers them all.  Plain data, so
+//summaries can be copied through encoded blocks as they are.
+struct ChannelSummary
+{
+    void clear();
+    void add(double value, quint64 message);
+    void addRows(const double *values, int rows, quint64 firstMessage);
+    void merge(const ChannelSummary &other); //other being of later messages
+    QJsonObject toJson(uint32_t freq) const;
+
+    quint64 count;
+    double mean;
+    double m2;
+    double sumSquares;
+    double min;
+    double max;
+    quint64 minMessage;
+    quint64 maxMessage;
+    int exponent;
+    qint64 firstBin;
+    qint64 lastBin;
+    quint64 bins[SUMMARY_BINS];
+
+private:
+    void addToBin(qint64 index, int indexExponent, quint64 count);
+};
+
+//Statistics of every motor channel and spot value instead of the samples, for --summary.  The
+//motor messages are summarised in groups of SUMMARY_GROUP_ROWS counted from the start of the
+//log: encode() summarises the whole groups in a batch (on whichever thread is encoding) and
+//passes the rows of any part group at either end through as they are, and append() finishes
+//those groups from the rows so every group is summarised from the same rows whatever the
+//batches were.  The groups are merged in order, so the results don't depend on the thread
+//count.  Spot value sets are few enough to add up as they are appended.  The report is
+//written as JSON (with the histograms) and CSV once the decode finishes.
+class SummarySink : public FrameSink
+{
+public:
+    SummarySink(QIODevice *json, QIODevice *csv, uint32_t freq, const QStringList &names, const QVector<int> &columns, const QStringList &spotNames);
+
+    void encode(const FrameBatch &batch, QByteArray &block) const override;
+    bool append(const QByteArray &block) override;
+    bool finish() override;
+
+private:
+    void addPending(const double *values, int rows, int stride, quint64 firstMessage);
+
+    QIODevice *json;
+    QIODevice *csv;
+    uint32_t freq;
+    QStringList names;
+    QVector<int> columns;
+    QStringList spotNames;
+    QVector<ChannelSummary> motor;
+    QVector<ChannelSummary> spots;
+    QVector<double> pending; //rows of the group being filled, a SUMMARY_GROUP_ROWS column per channel
+    int pendingRows;
+    quint64 pendingFirst;
+};
+
+#endif // SIGNALSUMMARY_H
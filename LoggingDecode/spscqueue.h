@@ -0,0 +1,76 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <QVector>
+
+#define SPSC_QUEUE_DEPTH 16
+#define SPSC_SPIN_COUNT 64
+
+//Bounded single producer / single consumer ring used between pipeline stages.  The only
+//shared state is the two indices, push() waits while the ring is full and pop() while it is
+//empty, so a fast stage can never run more than the queue depth ahead of a slow one.
+template<typename T> class SpscQueue
+{
+public:
+    explicit SpscQueue(int depth = SPSC_QUEUE_DEPTH) :
+        slots(depth + 1),
+        ring(slots.data()),
+        size(slots.size()),
+        head(0),
+        tail(0),
+        closed(false)
+    {
+    }
+
+    //producer side
+    void push(T item)
+    {
+        int next = advance(tail.load(std::memory_order_relaxed));
+        for(int spin=0;next == head.load(std::memory_order_acquire);spin++)
+            backOff(spin);
+        int at = tail.load(std::memory_order_relaxed);
+        ring[at] = std::move(item);
+        tail.store(next, std::memory_order_release);
+    }
+
+    //no more items will be pushed
+    void close() { closed.store(true, std::memory_order_release); }
+
+    //consumer side, returns false once the queue is closed and drained
+    bool pop(T &item)
+    {
+        int at = head.load(std::memory_order_relaxed);
+        for(int spin=0;at == tail.load(std::memory_order_acquire);spin++)
+        {
+            if(closed.load(std::memory_order_acquire) && (at == tail.load(std::memory_order_acquire)))
+                return false;
+            backOff(spin);
+        }
+        item = std::move(ring[at]);
+        ring[at] = T();
+        head.store(advance(at), std::memory_order_release);
+        return true;
+    }
+
+private:
+    int advance(int index) const { return (index + 1 == size) ? 0 : index + 1; }
+    static void backOff(int spin)
+    {
+        if(spin < SPSC_SPIN_COUNT)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    QVector<T> slots;
+    T *ring; //taken once so neither side ever touches the QVector's shared data
+    int size;
+    alignas(64) std::atomic<int> head;
+    alignas(64) std::atomic<int> tail;
+    std::atomic<bool> closed;
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,72 @@
+#include "srwriter.h"
+
+#include <cstring>
+
+SrWriter::SrWriter(const QString &fileName, uint32_t sampleRate, const QStringList &channels, bool compress) :
+    zip(fileName),
+    sampleRate(sampleRate),
+    channels(channels),
+    channelCount(channels.size()),
+    compress(compress),
+    count(0),
+    chunk(0)
+{
+}
+
+bool SrWriter::open()
+{
+    if(!zip.open())
+        return false;
+    samples.resize(channelCount * SR_CHUNK_SAMPLES);
+    count = 0;
+    chunk = 0;
+    return zip.addFile("version", QByteArray("2"), false);
+}
+
+//append rows of samples given a channel at a time, data holds rows values for each channel in turn,
+//false if a chunk couldn't be written
+bool SrWriter::addChannels(const float *data, int rows)
+{
+    bool ok = true;
+    int row = 0;
+    while(row < rows)
+    {
+        int count = qMin(rows - row, SR_CHUNK_SAMPLES - this->count);
+        for(int i=0;i<channelCount;i++)
+            memcpy(samples.data() + i*SR_CHUNK_SAMPLES + this->count, data + i*rows + row, count*sizeof(float));
+        row += count;
+        this->count += count;
+        if(this->count == SR_CHUNK_SAMPLES)
+            ok &= writeChunk();
+    }
+    return ok;
+}
+
+bool SrWriter::writeChunk()
+{
+    bool ok = true;
+    chunk++;
+    for(int i=0;i<channelCount;i++)
+    {
+        QString name = QStringLiteral("analog-1-%1-%2").arg(i+1).arg(chunk);
+        ok &= zip.addFile(name, (const char *)(samples.constData() + i*SR_CHUNK_SAMPLES), count*sizeof(float), compress);
+    }
+    count = 0;
+    return ok;
+}
+
+bool SrWriter::close()
+{
+    bool ok = true;
+    if((count > 0) || (chunk == 0))
+        ok = writeChunk();
+    samples.clear();
+
+    QByteArray metadata = "[global]\nsigrok version=0.5.2\n\n[device 1]\nsamplerate=";
+    metadata += QByteArray::number(sampleRate) + " Hz\ntotal analog=" + QByteArray::number(channelCount) + '\n';
+    for(int i=0;i<channelCount;i++)
+        metadata += "analog" + QByteArray::number(i+1) + '=' + channels[i].toUtf8() + '\n';
+    metadata += "unitsize=1";
+    ok &= zip.addFile("metadata", metadata, compress);
+    return zip.close() && ok;
+}
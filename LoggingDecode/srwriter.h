@@ -0,0 +1,37 @@
+#ifndef SRWRITER_H
+#define SRWRITER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "zipwriter.h"
+
+#define SR_CHUNK_SAMPLES (512*1024)
+
+//PulseView (sigrok session) file writer.  Samples are collected per channel and every
+//SR_CHUNK_SAMPLES they are written into the archive as the next analog-1-<channel>-<chunk>
+//entry, so the .sr file is built as the data is decoded with no temporary files.
+class SrWriter
+{
+public:
+    SrWriter(const QString &fileName, uint32_t sampleRate, const QStringList &channels, bool compress);
+
+    bool open();
+    bool addChannels(const float *data, int rows);
+    bool close();
+
+private:
+    bool writeChunk();
+
+    ZipWriter zip;
+    uint32_t sampleRate;
+    QStringList channels;
+    int channelCount;
+    bool compress;
+    QVector<float> samples; //channel major, SR_CHUNK_SAMPLES per channel
+    int count;
+    int chunk;
+};
+
+#endif // SRWRITER_H
@@ -0,0 +1,395 @@
+#include "triggercapture.h"
+
+#include <QDebug>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "csvwriter.h"
+
+bool TriggerExpression::parse(const QString &text)
+{
+    conditions.clear();
+    foreach(const QString &part, text.split(','))
+    {
+        Condition condition;
+        int at = 0;
+        while((at < part.size()) && (part[at] != '<') && (part[at] != '>'))
+            at++;
+        if(at >= part.size())
+            return false;
+        condition.greater = part[at] == '>';
+        condition.orEqual = (at + 1 < part.size()) && (part[at + 1] == '=');
+        bool ok;
+        condition.threshold = part.mid(at + (condition.orEqual ? 2 : 1)).trimmed().toDouble(&ok);
+        if(!ok)
+            return false;
+
+        QString name = part.left(at).trimmed();
+        condition.kind = KindValue;
+        if(name.startsWith("abs(") && name.endsWith(')'))
+        {
+            condition.kind = KindAbs;
+            name = name.mid(4, name.size() - 5).trimmed();
+        }
+        else if(name.startsWith("delta(") && name.endsWith(')'))
+        {
+            condition.kind = KindDelta;
+            name = name.mid(6, name.size() - 7).trimmed();
+        }
+        if(name.isEmpty())
+            return false;
+        condition.name = name;
+        condition.column = -1;
+        condition.wrap = false;
+        conditions.append(condition);
+    }
+    return !conditions.isEmpty();
+}
+
+QStringList TriggerExpression::channels() const
+{
+    QStringList names;
+    foreach(const Condition &condition, conditions)
+        if(!names.contains(condition.name))
+            names << condition.name;
+    return names;
+}
+
+//find each channel's column, false if one isn't decoded from this log
+bool TriggerExpression::compile(const QVector<varDefinitions> &varDefs, const DecodePlan &plan)
+{
+    bool ok = true;
+    for(int i=0;i<conditions.size();i++)
+    {
+        Condition &condition = conditions[i];
+        condition.column = -1;
+        for(int j=0;j<varDefs.size();j++)
+            if((varDefs[j].isOutput || varDefs[j].isDecoded) && (varDefs[j].name == condition.name))
+                condition.column = j;
+        if(condition.column < 0)
+        {
+            qDebug("Trigger channel %s is not in the log", qPrintable(condition.name));
+            ok = false;
+            continue;
+        }
+        condition.wrap = plan.transform(condition.column) == TransformAngle;
+    }
+    return ok;
+}
+
+double TriggerExpression::delta(const Condition &condition, double value, double previous) const
+{
+    double change = value - previous;
+    if(condition.wrap)
+        change = std::remainder(change, 360.0);
+    return std::fabs(change);
+}
+
+void TriggerExpression::evaluate(const FrameBatch &batch, uchar *hits) const
+{
+    memset(hits, 0, batch.rows);
+    foreach(const Condition &condition, conditions)
+    {
+        const double *in = batch.column(condition.column);
+        switch(condition.kind)
+        {
+        case KindValue:
+            for(int row=0;row<batch.rows;row++)
+                hits[row] |= fires(condition, in[row]);
+            break;
+        case KindAbs:
+            for(int row=0;row<batch.rows;row++)
+                hits[row] |= fires(condition, std::fabs(in[row]));
+            break;
+        case KindDelta:
+            for(int row=1;row<batch.rows;row++)
+                hits[row] |= fires(condition, delta(condition, in[row], in[row - 1]));
+            break;
+        }
+    }
+}
+
+bool TriggerExpression::deltaHit(const double *values, int stride, const double *previous) const
+{
+    foreach(const Condition &condition, conditions)
+        if((condition.kind == KindDelta) && fires(condition, delta(condition, values[condition.column*stride], previous[condition.column])))
+            return true;
+    return false;
+}
+
+//each batch is its first message and row count, a hit flag per row (padded to 8 bytes), the
+//runs of rows passed on as first row and row count pairs and then the columns of each run in
+//turn
+struct TriggerBlockHeader
+{
+    quint64 firstMessage;
+    qint32 rows;
+    qint32 hits;
+    qint32 runs;
+    qint32 unused;
+};
+
+TriggerSink::TriggerSink(const TriggerExpression &trigger, const QString &baseName, uint32_t freq, int columns, int preRows, int postRows, int maxSegments) :
+    trigger(trigger),
+    baseName(baseName),
+    freq(freq),
+    columnCount(columns),
+    preRows(preRows),
+    postRows(postRows),
+    maxSegments(maxSegments),
+    csv(false),
+    pv(false),
+    pvCompress(true),
+    ring(preRows*columns),
+    ringMessages(preRows),
+    ringNext(0),
+    ringRows(0),
+    previous(columns),
+    hasPrevious(false),
+    inSegment(false),
+    until(0),
+    nextUnwritten(0),
+    segmentFirst(0),
+    segments(0),
+    limitReported(false),
+    ok(true)
+{
+    rows.reset(columns, 0);
+}
+
+void TriggerSink::setMotorCsv(const QStringList &names, const QVector<int> &columns, const QVector<int> &digits)
+{
+    csv = true;
+    csvNames = names;
+    csvColumns = columns;
+    csvDigits = digits;
+}
+
+void TriggerSink::setPulseView(const QStringList &channels, const QVector<int> &columns, bool compress)
+{
+    pv = true;
+    pvChannels = channels;
+    pvColumns = columns;
+    pvCompress = compress;
+}
+
+//Only the rows append() can use are passed on: the first postRows + 1 (a segment carried on
+//from the last batch, or a delta hit on the first row that only append() can see), preRows
+//before to postRows after each hit, and the last preRows (at least the last row, for the delta
+//conditions) to keep the ring filled.  Rows between those are never written and would only
+//pass through the ring before being pushed out of it.
+void TriggerSink::encode(const FrameBatch &batch, QByteArray &block) const
+{
+    int hitBytes = (batch.rows + 7) & ~7;
+    int start = block.size();
+    block.resize(start + sizeof(TriggerBlockHeader) + hitBytes);
+    uchar *hits = (uchar *)(block.data() + start + sizeof(TriggerBlockHeader));
+    trigger.evaluate(batch, hits);
+
+    //the row ranges start in order, so overlapping ones can be joined as they are added
+    QVector<qint32> runs;
+    int hitCount = 0;
+    auto addRows = [&](int first, int last)
+    {
+        first = qMax(first, 0);
+        last = qMin(last, batch.rows);
+        if(first >= last)
+            return;
+        if(!runs.isEmpty() && (first <= runs[runs.size() - 2] + runs.last()))
+            runs.last() = qMax(runs.last(), last - runs[runs.size() - 2]);
+        else
+            runs << first << last - first;
+    };
+    addRows(0, postRows + 1);
+    for(int row=0;row<batch.rows;row++)
+    {
+        if(hits[row])
+        {
+            hitCount++;
+            addRows(row - preRows, row + postRows + 1);
+        }
+    }
+    addRows(batch.rows - qMax(preRows, 1), batch.rows);
+
+    int runBytes = runs.size()*sizeof(qint32);
+    int copied = 0;
+    for(int i=0;i<runs.size();i+=2)
+        copied += runs[i + 1];
+    block.resize(start + sizeof(TriggerBlockHeader) + hitBytes + runBytes + copied*columnCount*sizeof(double));
+    TriggerBlockHeader *header = (TriggerBlockHeader *)(block.data() + start);
+    header->firstMessage = batch.firstMessage;
+    header->rows = batch.rows;
+    header->hits = hitCount;
+    header->runs = runs.size()/2;
+    header->unused = 0;
+    qint32 *runList = (qint32 *)((char *)(header + 1) + hitBytes);
+    memcpy(runList, runs.constData(), runBytes);
+
+    double *out = (double *)((char *)runList + runBytes);
+    for(int i=0;i<runs.size();i+=2)
+        for(int j=0;j<columnCount;j++,out+=runs[i + 1])
+            memcpy(out, batch.column(j) + runs[i], runs[i + 1]*sizeof(double));
+}
+
+bool TriggerSink::append(const QByteArray &block)
+{
+    const char *in = block.constData();
+    const char *end = in + block.size();
+    while(in + sizeof(TriggerBlockHeader) <= end)
+    {
+        const TriggerBlockHeader *header = (const TriggerBlockHeader *)in;
+        const uchar *hits = (const uchar *)(header + 1);
+        const qint32 *runs = (const qint32 *)(hits + ((header->rows + 7) & ~7));
+        const double *values = (const double *)(runs + header->runs*2);
+        //a delta hit on the first row is against the last row of the batch before
+        bool firstDelta = (header->runs > 0) && hasPrevious && trigger.deltaHit(values, runs[1], previous.constData());
+        //with no segment going and nothing firing only the end of the batch is needed, for the ring
+        bool quiet = !inSegment && (header->hits == 0) && !firstDelta;
+        for(int run=0;run<header->runs;run++)
+        {
+            int first = runs[run*2];
+            int count = runs[run*2 + 1];
+            bool last = run == header->runs - 1;
+            if(inSegment && (first > 0) && (header->firstMessage + first - 1 > until + preRows))
+                closeSegment(); //as it would have been on one of the rows left out before this run
+            if(!quiet || last)
+            {
+                for(int row=quiet ? qMax(count - preRows, 0) : 0;row<count;row++)
+                    addRow(values + row, count, header->firstMessage + first + row, hits[first + row] || ((first + row == 0) && firstDelta));
+            }
+            if(last)
+            {
+                for(int i=0;i<columnCount;i++)
+                    previous[i] = values[i*count + count - 1];
+                hasPrevious = true;
+            }
+            values += count*columnCount;
+        }
+        in = (const char *)values;
+    }
+    return ok;
+}
+
+//one message of a run, its values stride apart
+void TriggerSink::addRow(const double *values, int stride, quint64 message, bool hit)
+{
+    if(hit && !inSegment)
+    {
+        if(segments < maxSegments)
+            openSegment();
+        else if(!limitReported)
+        {
+            qDebug("Trigger segment limit reached, later hits are ignored");
+            limitReported = true;
+        }
+    }
+    if(hit && inSegment)
+    { //the messages before the hit that aren't in the segment yet, all still in the ring
+        for(int i=0;i<ringRows;i++)
+        {
+            int slot = (ringNext - ringRows + i + preRows)%preRows;
+            if(ringMessages[slot] >= nextUnwritten)
+                writeRow(ring.constData() + slot*columnCount, 1, ringMessages[slot]);
+        }
+        until = message + postRows;
+    }
+    if(inSegment && (message <= until))
+        writeRow(values, stride, message);
+    else if(inSegment && (message > until + preRows))
+        closeSegment();
+
+    if(preRows > 0)
+    {
+        double *slot = ring.data() + ringNext*columnCount;
+        for(int i=0;i<columnCount;i++)
+            slot[i] = values[i*stride];
+        ringMessages[ringNext] = message;
+        ringNext = (ringNext + 1)%preRows;
+        ringRows = qMin(ringRows + 1, preRows);
+    }
+}
+
+void TriggerSink::openSegment()
+{
+    segments++;
+    inSegment = true;
+    segmentFirst = std::numeric_limits<quint64>::max();
+    QString name = baseName + QString("_trigger%1").arg(segments, 3, 10, QChar('0'));
+    if(csv)
+    {
+        csvFile.reset(new QFile(name + "_motor_data.csv"));
+        if(csvFile->open(QFile::WriteOnly))
+            csvSink.reset(new MotorCsvSink(csvFile.data(), freq, csvNames, csvColumns, csvDigits));
+        else
+            ok = false;
+    }
+    if(pv)
+    {
+        srFile.reset(new SrWriter(name + ".sr", freq, pvChannels, pvCompress));
+        if(srFile->open())
+            srSink.reset(new SrSink(*srFile, pvColumns));
+        else
+            ok = false;
+    }
+    if(!ok)
+        qDebug("Could not open trigger segment %d files", segments);
+}
+
+void TriggerSink::closeSegment()
+{
+    writeSegment();
+    if(!csvSink.isNull())
+    {
+        csvSink.reset();
+        csvFile->close();
+    }
+    if(!srSink.isNull())
+    {
+        srSink.reset();
+        ok &= srFile->close();
+    }
+    csvFile.reset();
+    srFile.reset();
+    inSegment = false;
+
+    MessageClock first(freq), last(freq);
+    first.seek(segmentFirst);
+    last.seek(nextUnwritten - 1);
+    qDebug("Trigger segment %d: %.6f to %.6f seconds", segments, first.micros()/1e6, last.micros()/1e6);
+}
+
+//one message into the segment, its values stride apart
+void TriggerSink::writeRow(const double *values, int stride, quint64 message)
+{
+    if((rows.rows > 0) && (message != rows.firstMessage + rows.rows))
+        writeSegment(); //messages lost in between
+    if(rows.rows == 0)
+        rows.firstMessage = message;
+    segmentFirst = qMin(segmentFirst, message);
+    for(int i=0;i<columnCount;i++)
+        rows.column(i)[rows.rows] = values[i*stride];
+    rows.rows++;
+    nextUnwritten = message + 1;
+    if(rows.rows == rows.capacity)
+        writeSegment();
+}
+
+void TriggerSink::writeSegment()
+{
+    if(rows.rows == 0)
+        return;
+    if(!csvSink.isNull())
+        ok &= csvSink->write(rows);
+    if(!srSink.isNull())
+        ok &= srSink->write(rows);
+    rows.rows = 0;
+}
+
+bool TriggerSink::finish()
+{
+    if(inSegment)
+        closeSegment();
+    qDebug("%d trigger segments written", segments);
+    return ok;
+}
@@ -0,0 +1,128 @@
+#ifndef TRIGGERCAPTURE_H
+#define TRIGGERCAPTURE_H
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "decodeplan.h"
+#include "framesinks.h"
+
+#define TRIGGER_DEFAULT_SECONDS 0.2  //kept before and after each hit
+#define TRIGGER_DEFAULT_SEGMENTS 100
+
+//A --trigger expression, conditions separated by commas, any one of which firing is a hit:
+//name>value or name<value (or >=, <=) on the channel, abs(name) on its size and delta(name) on
+//its change since the previous message (angles wrapping at 360).  Parsed from the text once,
+//then compiled against a log's layout to column indexes for the decode.
+class TriggerExpression
+{
+public:
+    bool parse(const QString &text);
+    QStringList channels() const;
+    bool compile(const QVector<varDefinitions> &varDefs, const DecodePlan &plan);
+
+    //set hits[row] for every row a condition fires on, the delta conditions from row 1
+    void evaluate(const FrameBatch &batch, uchar *hits) const;
+    //the delta conditions for a row whose values are stride apart, against the message before it
+    bool deltaHit(const double *values, int stride, const double *previous) const;
+
+private:
+    enum Kind
+    {
+        KindValue,
+        KindAbs,
+        KindDelta
+    };
+
+    struct Condition
+    {
+        QString name;
+        Kind kind;
+        bool greater;
+        bool orEqual;
+        double threshold;
+        int column;
+        bool wrap; //delta of an angle
+    };
+
+    bool fires(const Condition &condition, double value) const
+    {
+        if(condition.greater)
+            return condition.orEqual ? (value >= condition.threshold) : (value > condition.threshold);
+        return condition.orEqual ? (value <= condition.threshold) : (value < condition.threshold);
+    }
+    double delta(const Condition &condition, double value, double previous) const;
+
+    QVector<Condition> conditions;
+};
+
+//Writes the motor data only around trigger hits, as numbered segments
+//[dest]_triggerNNN_motor_data.csv and [dest]_triggerNNN.sr.  The trigger is evaluated on each
+//batch in encode(), which passes the hits on with only the rows that can end up in a segment.
+//append() keeps the last preRows messages in a ring so that a hit can start its segment that
+//far back, and carries the segment on until postRows after the last hit.  A hit within preRows
+//of the end of a segment carries on the same segment, so overlapping windows come out as one.
+//After maxSegments segments further hits are ignored.
+class TriggerSink : public FrameSink
+{
+public:
+    TriggerSink(const TriggerExpression &trigger, const QString &baseName, uint32_t freq, int columns, int preRows, int postRows, int maxSegments);
+
+    void setMotorCsv(const QStringList &names, const QVector<int> &columns, const QVector<int> &digits);
+    void setPulseView(const QStringList &channels, const QVector<int> &columns, bool compress);
+
+    void encode(const FrameBatch &batch, QByteArray &block) const override;
+    bool append(const QByteArray &block) override;
+    bool finish() override;
+
+    int segmentCount() const { return segments; }
+
+private:
+    void addRow(const double *values, int stride, quint64 message, bool hit);
+    void openSegment();
+    void closeSegment();
+    void writeRow(const double *values, int stride, quint64 message);
+    void writeSegment();
+
+    TriggerExpression trigger;
+    QString baseName;
+    uint32_t freq;
+    int columnCount;
+    int preRows;
+    int postRows;
+    int maxSegments;
+
+    bool csv;
+    QStringList csvNames;
+    QVector<int> csvColumns;
+    QVector<int> csvDigits;
+    bool pv;
+    QStringList pvChannels;
+    QVector<int> pvColumns;
+    bool pvCompress;
+
+    QVector<double> ring;          //the last preRows messages, a row of columnCount at a time
+    QVector<quint64> ringMessages;
+    int ringNext;
+    int ringRows;
+    QVector<double> previous;      //last message appended, for delta conditions
+    bool hasPrevious;
+
+    bool inSegment;
+    quint64 until;        //last message of the segment so far
+    quint64 nextUnwritten;
+    quint64 segmentFirst;
+    int segments;
+    bool limitReported;
+    bool ok;
+    FrameBatch rows;      //segment messages waiting to be written
+    QScopedPointer<QFile> csvFile;
+    QScopedPointer<MotorCsvSink> csvSink;
+    QScopedPointer<SrWriter> srFile;
+    QScopedPointer<SrSink> srSink;
+};
+
+#endif // TRIGGERCAPTURE_H
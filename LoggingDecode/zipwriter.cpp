@@ -0,0 +1,231 @@
+#include "zipwriter.h"
+
+#include <QDateTime>
+#include <zlib.h>
+
+#define ZIP_LOCAL_HEADER 0x04034b50
+#define ZIP_CENTRAL_HEADER 0x02014b50
+#define ZIP_END_OF_DIR 0x06054b50
+#define ZIP64_END_OF_DIR 0x06064b50
+#define ZIP64_END_LOCATOR 0x07064b50
+#define ZIP64_EXTRA_ID 0x0001
+#define ZIP_METHOD_STORE 0
+#define ZIP_METHOD_DEFLATE 8
+#define ZIP_VERSION_DEFAULT 20
+#define ZIP_VERSION_ZIP64 45
+#define ZIP_MADE_BY_UNIX (0x0300 | ZIP_VERSION_ZIP64)
+#define ZIP32_LIMIT 0xffffffffULL
+
+static void put16(QByteArray &out, quint16 value)
+{
+    out.append((char)(value & 0xff));
+    out.append((char)(value >> 8));
+}
+
+static void put32(QByteArray &out, quint32 value)
+{
+    put16(out, value & 0xffff);
+    put16(out, value >> 16);
+}
+
+static void put64(QByteArray &out, quint64 value)
+{
+    put32(out, value & 0xffffffff);
+    put32(out, value >> 32);
+}
+
+ZipWriter::ZipWriter(const QString &fileName) :
+    file(fileName),
+    offset(0),
+    dosTime(0),
+    dosDate(0),
+    failed(false)
+{
+}
+
+ZipWriter::~ZipWriter()
+{
+    if(file.isOpen())
+        close();
+}
+
+bool ZipWriter::open()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    dosTime = (now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2);
+    dosDate = ((now.date().year() - 1980) << 9) | (now.date().month() << 5) | now.date().day();
+    entries.clear();
+    offset = 0;
+    failed = !file.open(QFile::WriteOnly);
+    return !failed;
+}
+
+bool ZipWriter::addFile(const QString &name, const char *data, qint64 size, bool compress)
+{
+    if(failed || !file.isOpen())
+        return false;
+
+    Entry entry;
+    entry.name = name.toUtf8();
+    entry.size = size;
+    entry.offset = offset;
+    entry.crc = 0;
+    for(qint64 done=0;done<size;)
+    { //crc32 takes a 32 bit length
+        uInt block = (uInt)qMin<qint64>(size - done, 0x40000000);
+        entry.crc = crc32(entry.crc, (const Bytef *)data + done, block);
+        done += block;
+    }
+
+    const char *payload = data;
+    entry.method = ZIP_METHOD_STORE;
+    entry.compressedSize = size;
+    if(compress && (size > 0))
+    {
+        z_stream stream = {};
+        if(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK)
+        {
+            uLong bound = deflateBound(&stream, size);
+            if((qint64)deflated.size() < (qint64)bound)
+                deflated.resize(bound);
+            stream.next_in = (Bytef *)data;
+            stream.avail_in = size;
+            stream.next_out = (Bytef *)deflated.data();
+            stream.avail_out = deflated.size();
+            if((deflate(&stream, Z_FINISH) == Z_STREAM_END) && ((qint64)stream.total_out < size))
+            { //only keep it if it actually got smaller
+                entry.method = ZIP_METHOD_DEFLATE;
+                entry.compressedSize = stream.total_out;
+                payload = deflated.constData();
+            }
+            deflateEnd(&stream);
+        }
+    }
+
+    bool zip64 = (entry.size >= ZIP32_LIMIT) || (entry.compressedSize >= ZIP32_LIMIT);
+    QByteArray header;
+    put32(header, ZIP_LOCAL_HEADER);
+    put16(header, zip64 ? ZIP_VERSION_ZIP64 : ZIP_VERSION_DEFAULT);
+    put16(header, 0); //flags
+    put16(header, entry.method);
+    put16(header, dosTime);
+    put16(header, dosDate);
+    put32(header, entry.crc);
+    put32(header, zip64 ? 0xffffffff : entry.compressedSize);
+    put32(header, zip64 ? 0xffffffff : entry.size);
+    put16(header, entry.name.size());
+    put16(header, zip64 ? 20 : 0);
+    header.append(entry.name);
+    if(zip64)
+    {
+        put16(header, ZIP64_EXTRA_ID);
+        put16(header, 16);
+        put64(header, entry.size);
+        put64(header, entry.compressedSize);
+    }
+
+    if((file.write(header) != header.size()) || (file.write(payload, entry.compressedSize) != (qint64)entry.compressedSize))
+    {
+        failed = true;
+        return false;
+    }
+    offset += header.size() + entry.compressedSize;
+    entries.append(entry);
+    return true;
+}
+
+bool ZipWriter::writeCentralDirectory()
+{
+    QByteArray directory;
+    quint64 directoryOffset = offset;
+    for(int i=0;i<entries.size();i++)
+    {
+        const Entry &entry = entries[i];
+        QByteArray extra;
+        if(entry.size >= ZIP32_LIMIT)
+            put64(extra, entry.size);
+        if(entry.compressedSize >= ZIP32_LIMIT)
+            put64(extra, entry.compressedSize);
+        if(entry.offset >= ZIP32_LIMIT)
+            put64(extra, entry.offset);
+        if(!extra.isEmpty())
+        {
+            QByteArray tag;
+            put16(tag, ZIP64_EXTRA_ID);
+            put16(tag, extra.size());
+            extra.prepend(tag);
+        }
+
+        put32(directory, ZIP_CENTRAL_HEADER);
+        put16(directory, ZIP_MADE_BY_UNIX);
+        put16(directory, extra.isEmpty() ? ZIP_VERSION_DEFAULT : ZIP_VERSION_ZIP64);
+        put16(directory, 0); //flags
+        put16(directory, entry.method);
+        put16(directory, dosTime);
+        put16(directory, dosDate);
+        put32(directory, entry.crc);
+        put32(directory, qMin<quint64>(entry.compressedSize, ZIP32_LIMIT));
+        put32(directory, qMin<quint64>(entry.size, ZIP32_LIMIT));
+        put16(directory, entry.name.size());
+        put16(directory, extra.size());
+        put16(directory, 0); //comment length
+        put16(directory, 0); //disk number
+        put16(directory, 0); //internal attributes
+        put32(directory, 0100644U << 16); //external attributes, regular file rw-r--r--
+        put32(directory, qMin<quint64>(entry.offset, ZIP32_LIMIT));
+        directory.append(entry.name);
+        directory.append(extra);
+
+        if(directory.size() > (1<<20))
+        {
+            if(file.write(directory) != directory.size())
+                return false;
+            offset += directory.size();
+            directory.clear();
+        }
+    }
+    offset += directory.size();
+    quint64 directorySize = offset - directoryOffset;
+
+    bool zip64 = (entries.size() >= 0xffff) || (directoryOffset >= ZIP32_LIMIT) || (directorySize >= ZIP32_LIMIT);
+    if(zip64)
+    {
+        quint64 zip64EndOffset = offset;
+        put32(directory, ZIP64_END_OF_DIR);
+        put64(directory, 44); //size of the rest of this record
+        put16(directory, ZIP_MADE_BY_UNIX);
+        put16(directory, ZIP_VERSION_ZIP64);
+        put32(directory, 0); //this disk
+        put32(directory, 0); //disk with the directory
+        put64(directory, entries.size());
+        put64(directory, entries.size());
+        put64(directory, directorySize);
+        put64(directory, directoryOffset);
+
+        put32(directory, ZIP64_END_LOCATOR);
+        put32(directory, 0);
+        put64(directory, zip64EndOffset);
+        put32(directory, 1); //total disks
+    }
+
+    put32(directory, ZIP_END_OF_DIR);
+    put16(directory, 0);
+    put16(directory, 0);
+    put16(directory, qMin(entries.size(), 0xffff));
+    put16(directory, qMin(entries.size(), 0xffff));
+    put32(directory, qMin<quint64>(directorySize, ZIP32_LIMIT));
+    put32(directory, qMin<quint64>(directoryOffset, ZIP32_LIMIT));
+    put16(directory, 0); //comment length
+    return file.write(directory) == directory.size();
+}
+
+//write the central directory and close the file, returns false if anything failed to write
+bool ZipWriter::close()
+{
+    if(!file.isOpen())
+        return false;
+    bool ok = !failed && writeCentralDirectory();
+    file.close();
+    deflated.clear();
+    return ok;
+}
@@ -0,0 +1,47 @@
+#ifndef ZIPWRITER_H
+#define ZIPWRITER_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+
+//Writes a zip archive a whole entry at a time, each entry either deflated or stored.
+//Switches to ZIP64 records when the archive grows past the 4 GB / 65535 entry limits.
+class ZipWriter
+{
+public:
+    explicit ZipWriter(const QString &fileName);
+    ~ZipWriter();
+
+    bool open();
+    bool addFile(const QString &name, const char *data, qint64 size, bool compress);
+    bool addFile(const QString &name, const QByteArray &data, bool compress)
+    {
+        return addFile(name, data.constData(), data.size(), compress);
+    }
+    bool close();
+
+private:
+    struct Entry
+    {
+        QByteArray name;
+        quint32 crc;
+        quint64 compressedSize;
+        quint64 size;
+        quint64 offset;
+        quint16 method;
+    };
+
+    bool writeCentralDirectory();
+
+    QFile file;
+    QVector<Entry> entries;
+    QByteArray deflated;
+    quint64 offset;
+    quint16 dosTime;
+    quint16 dosDate;
+    bool failed;
+};
+
+#endif // ZIPWRITER_H
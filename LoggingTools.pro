@@ -0,0 +1,14 @@
+# The decoder library and command line tool, plus the tools for testing them: a generator for
+# synthetic logs and a benchmark that times the decoder on them and checks its outputs.
+TEMPLATE = subdirs
+
+SUBDIRS += \
+        LogDecodeLib \
+        LoggingDecode \
+        LogGenerator \
+        LogBenchmark
+
+LoggingDecode.depends = LogDecodeLib
+
+# the benchmark runs the decoder built alongside it
+LogBenchmark.depends = LoggingDecode